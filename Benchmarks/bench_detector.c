@@ -0,0 +1,321 @@
+#include "../all_functions.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Benchmark of the deadlock detector on synthetic states.
+ * For every scenario and every point of a grid of thread counts and resource type counts, a state is generated and
+ * check_dlock(), every heuristic of select_thr_to_cncl() and the full detect-and-resolve loop are timed, without any
+ * worker thread. Every measurement is repeated until it runs for at least the given time. The time per operation, the
+ * throughput and the number of heap allocations per operation are printed as CSV, or as JSON lines with -j.
+ *
+ * Scenarios:
+ *   safe        every thread can finish, in a random order that makes each request depend on earlier releases
+ *   deadlocked  as safe, plus a quarter of the threads whose requests exceed what the others can ever release
+ *   nearly      as deadlocked, except that one of those threads can finish and unblocks all the others
+ *   skewed      safe, with a few threads holding most of the instances and most threads holding nothing
+ *
+ *   gcc -O2 Benchmarks/bench_detector.c -lpthread -o bench_detector
+ *   ./bench_detector [-j] [max_threads] [max_resource_types] [min_seconds_per_measure]
+ */
+
+/* Counting the heap allocations by interposing the allocator */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *p, size_t size);
+extern void *__libc_memalign(size_t align, size_t size);
+extern void __libc_free(void *p);
+long bench_allocs = 0;
+
+void *malloc(size_t size){
+    __atomic_add_fetch(&bench_allocs, 1, __ATOMIC_RELAXED);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size){
+    __atomic_add_fetch(&bench_allocs, 1, __ATOMIC_RELAXED);
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *p, size_t size){
+    __atomic_add_fetch(&bench_allocs, 1, __ATOMIC_RELAXED);
+    return __libc_realloc(p, size);
+}
+
+void *aligned_alloc(size_t align, size_t size){
+    __atomic_add_fetch(&bench_allocs, 1, __ATOMIC_RELAXED);
+    return __libc_memalign(align, size);
+}
+
+void free(void *p){
+    __libc_free(p);
+}
+
+enum {SCN_SAFE, SCN_DEADLOCKED, SCN_NEARLY, SCN_SKEWED, SCN_COUNT};
+const char *scenario_names[SCN_COUNT] = {"safe", "deadlocked", "nearly", "skewed"};
+
+bool json = false;
+double min_seconds = 0.2;
+
+/* Pristine copy of the generated state, restored before every detect-and-resolve run */
+state_store pristine;
+int *pristine_available;
+
+unsigned int gen_seed;
+
+int gen_rand(int bound){
+    return (bound > 0) ? rand_r(&gen_seed) % bound : 0;
+}
+
+/**
+ * Function to generate the state of a scenario into the global allocation, request and available_rcs.
+ */
+void generate(int scenario, int n_thr, int n_rcs){
+    gen_seed = 42 + scenario * 7919 + n_thr * 31 + n_rcs;
+    for(int i = 0; i < n_thr; i++){
+        for(int j = 0; j < n_rcs; j++){
+            allocation[i][j] = 0;
+            request[i][j] = 0;
+        }
+    }
+    int n_dlock = (scenario == SCN_DEADLOCKED || scenario == SCN_NEARLY) ? max(2, n_thr / 4) : 0;
+    int n_safe = n_thr - n_dlock;
+
+    /* Finishing order of the safe threads: each request fits in what is available once the earlier threads finish */
+    int order[n_safe > 0 ? n_safe : 1];
+    for(int i = 0; i < n_safe; i++){
+        order[i] = i;
+    }
+    for(int i = n_safe - 1; i > 0; i--){
+        int k = gen_rand(i + 1), t = order[i];
+        order[i] = order[k];
+        order[k] = t;
+    }
+    int work[n_rcs];
+    for(int j = 0; j < n_rcs; j++){
+        available_rcs[j] = work[j] = 1 + gen_rand(2);
+    }
+    for(int k = 0; k < n_safe; k++){
+        int i = order[k];
+        bool holder = (scenario != SCN_SKEWED) || (gen_rand(20) == 0);
+        for(int j = 0; j < n_rcs; j++){
+            if(gen_rand(3) == 0)
+                request[i][j] = gen_rand(work[j] + 1);
+            if(holder)
+                allocation[i][j] = (scenario == SCN_SKEWED) ? gen_rand(64) : gen_rand(3);
+        }
+        for(int j = 0; j < n_rcs; j++){
+            work[j] += allocation[i][j];
+        }
+    }
+
+    /* Threads in deadlock: each holds instances and requests more of one resource type than can ever be released */
+    for(int d = n_safe; d < n_thr; d++){
+        for(int j = 0; j < n_rcs; j++){
+            allocation[d][j] = 1 + gen_rand(2);
+        }
+        int jd = gen_rand(n_rcs);
+        request[d][jd] = work[jd] + 1;
+    }
+    if(scenario == SCN_NEARLY){
+        /* The key thread can finish, and releases enough for every other thread in deadlock */
+        int key = n_safe;
+        for(int j = 0; j < n_rcs; j++){
+            request[key][j] = 0;
+            allocation[key][j] = 2 * n_thr;
+        }
+    }
+}
+
+void snapshot_state(){
+    for(int i = 0; i < max_threads; i++){
+        memcpy(pristine.allocation[i], allocation[i], sizeof(int) * total_types_rcs);
+        memcpy(pristine.request[i], request[i], sizeof(int) * total_types_rcs);
+    }
+    memcpy(pristine_available, available_rcs, sizeof(int) * total_types_rcs);
+}
+
+void restore_state(){
+    for(int i = 0; i < max_threads; i++){
+        memcpy(allocation[i], pristine.allocation[i], sizeof(int) * total_types_rcs);
+        memcpy(request[i], pristine.request[i], sizeof(int) * total_types_rcs);
+    }
+    memcpy(available_rcs, pristine_available, sizeof(int) * total_types_rcs);
+    for(int i = 0; i < max_threads; i++){
+        as_rebuild(&astats, i, allocation[i]);
+    }
+}
+
+double now_sec(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Operations that can be timed */
+enum {OP_CHECK, OP_HEURISTIC, OP_RESTORE, OP_RESOLVE};
+
+int *bench_dlock;   /* Deadlocked set of the generated state */
+int *bench_scratch;
+int resolved_victims;
+
+/**
+ * Function to resolve every deadlock of the live state as the detector does, resuming the reduction after each victim.
+ */
+void resolve_all(){
+    dlock_state st = {allocation, request, available_rcs};
+    int work[total_types_rcs];
+    bool finish[max_threads];
+    resolved_victims = 0;
+    for(int i = 0; i < max_threads; i++){
+        bench_scratch[i] = -1;
+    }
+    reduction_init(&st, work, finish);
+    bool is_dlock = reduce_dlock(&st, work, finish, false, bench_scratch);
+    while(is_dlock){
+        int victim = select_thr_to_cncl(bench_scratch);
+        row_add(work, allocation[victim], total_types_rcs);
+        resolve_dlock(victim);
+        finish[victim] = true;
+        resolved_victims += 1;
+        for(int i = 0; i < max_threads; i++){
+            bench_scratch[i] = -1;
+        }
+        is_dlock = reduce_dlock(&st, work, finish, true, bench_scratch);
+    }
+}
+
+void run_op(int op){
+    switch(op){
+        case OP_CHECK:
+            check_dlock(bench_scratch);
+            break;
+        case OP_HEURISTIC:
+            select_thr_to_cncl(bench_dlock);
+            break;
+        case OP_RESTORE:
+            restore_state();
+            break;
+        case OP_RESOLVE:
+            restore_state();
+            resolve_all();
+            break;
+    }
+}
+
+typedef struct {
+    long iterations;
+    double ns_per_op;
+    double allocs_per_op;
+} measure;
+
+/**
+ * Function to time an operation, doubling the number of iterations until they take at least min_seconds.
+ */
+measure time_op(int op){
+    measure m = {0, 0, 0};
+    long iters = 1;
+    while(true){
+        long allocs0 = __atomic_load_n(&bench_allocs, __ATOMIC_RELAXED);
+        double t0 = now_sec();
+        for(long k = 0; k < iters; k++){
+            run_op(op);
+        }
+        double elapsed = now_sec() - t0;
+        long allocs = __atomic_load_n(&bench_allocs, __ATOMIC_RELAXED) - allocs0;
+        if(elapsed >= min_seconds || iters >= (1L << 30)){
+            m.iterations = iters;
+            m.ns_per_op = elapsed * 1e9 / iters;
+            m.allocs_per_op = (double)allocs / iters;
+            return m;
+        }
+        iters *= 2;
+    }
+}
+
+void report(const char *scenario, int n_thr, int n_rcs, const char *op, measure m, int dlocked){
+    double ops_per_sec = (m.ns_per_op > 0) ? 1e9 / m.ns_per_op : 0;
+    if(json){
+        printf("{\"scenario\":\"%s\",\"threads\":%d,\"resource_types\":%d,\"op\":\"%s\",\"deadlocked\":%d,"
+               "\"iterations\":%ld,\"ns_per_op\":%.1f,\"ops_per_sec\":%.1f,\"allocs_per_op\":%.2f}\n",
+               scenario, n_thr, n_rcs, op, dlocked, m.iterations, m.ns_per_op, ops_per_sec, m.allocs_per_op);
+    }else{
+        printf("%s,%d,%d,%s,%d,%ld,%.1f,%.1f,%.2f\n", scenario, n_thr, n_rcs, op, dlocked, m.iterations, m.ns_per_op,
+               ops_per_sec, m.allocs_per_op);
+    }
+    fflush(stdout);
+}
+
+void bench_point(int scenario, int n_thr, int n_rcs){
+    max_threads = n_thr;
+    total_types_rcs = n_rcs;
+    available_rcs = (int *)malloc(sizeof(int) * n_rcs);
+    pristine_available = (int *)malloc(sizeof(int) * n_rcs);
+    bench_dlock = (int *)malloc(sizeof(int) * n_thr);
+    bench_scratch = (int *)malloc(sizeof(int) * n_thr);
+    ss_init_ex(&store, n_thr, n_rcs, false, false, true);
+    ss_init_ex(&pristine, n_thr, n_rcs, false, false, true);
+    as_init(&astats, n_thr, n_rcs);
+    allocation = store.allocation;
+    request = store.request;
+    cur_request = store.cur_request;
+
+    generate(scenario, n_thr, n_rcs);
+    snapshot_state();
+    restore_state();    /* Building the aggregates of the generated allocation */
+    for(int i = 0; i < n_thr; i++){
+        bench_dlock[i] = -1;
+    }
+    bool is_dlock = check_dlock(bench_dlock);
+    int dlocked = 0;
+    while(dlocked < n_thr && bench_dlock[dlocked] != -1)
+        dlocked++;
+    const char *name = scenario_names[scenario];
+
+    report(name, n_thr, n_rcs, "check_dlock", time_op(OP_CHECK), dlocked);
+    if(is_dlock){
+        const char *heuristics[] = {"heuristic_1", "heuristic_2", "heuristic_3", "heuristic_4", "heuristic_5"};
+        for(int h = 1; h <= 5; h++){
+            heuristic_no = h;
+            report(name, n_thr, n_rcs, heuristics[h - 1], time_op(OP_HEURISTIC), dlocked);
+        }
+    }
+
+    /* The detect-and-resolve loop restores the state first; the time of the restore alone is subtracted */
+    heuristic_no = 1;
+    measure restore = time_op(OP_RESTORE);
+    measure resolve = time_op(OP_RESOLVE);
+    resolve.ns_per_op = (resolve.ns_per_op > restore.ns_per_op) ? resolve.ns_per_op - restore.ns_per_op : 0;
+    resolve.allocs_per_op -= restore.allocs_per_op;
+    report(name, n_thr, n_rcs, "detect_resolve", resolve, dlocked);
+
+    ss_destroy(&store);
+    ss_destroy(&pristine);
+    as_destroy(&astats);
+    free(available_rcs);
+    free(pristine_available);
+    free(bench_dlock);
+    free(bench_scratch);
+}
+
+int main(int argc, char *argv[]){
+    int a = 1;
+    if(argc > a && strcmp(argv[a], "-j") == 0){
+        json = true;
+        a++;
+    }
+    int max_thr = (argc > a) ? atoi(argv[a]) : 4096;
+    int max_rcs = (argc > a + 1) ? atoi(argv[a + 1]) : 64;
+    min_seconds = (argc > a + 2) ? atof(argv[a + 2]) : 0.2;
+    simd_init();
+    if(!json)
+        printf("scenario,threads,resource_types,op,deadlocked,iterations,ns_per_op,ops_per_sec,allocs_per_op\n");
+    for(int scenario = 0; scenario < SCN_COUNT; scenario++){
+        for(int n_thr = 16; n_thr <= max_thr; n_thr *= 4){
+            for(int n_rcs = 4; n_rcs <= max_rcs; n_rcs *= 4){
+                bench_point(scenario, n_thr, n_rcs);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include "../all_functions.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Thread-count scaling benchmark of the locking modes.
+ * Every worker repeatedly requests a random number of instances of a random resource type and releases everything it
+ * holds, so no deadlock can form, while a detector thread examines the state every millisecond. The number of
+ * allocate/release cycles per second is printed as CSV for LOCK_GLOBAL, LOCK_SHARDED, and LOCK_SHARDED with optimistic
+ * snapshots.
+ *
+ *   gcc -O2 Benchmarks/bench_lock_scaling.c -lpthread -o bench_lock_scaling
+ *   ./bench_lock_scaling [max_threads] [resource_types] [seconds_per_run]
+ */
+
+volatile bool bench_stop = false;
+long *bench_ops = NULL;
+
+void* bench_worker(void *idx){
+    int my_idx = *((int*) idx);
+    long ops = 0;
+    while(!bench_stop){
+        int ri = rand_r(&thr_seeds[my_idx]) % total_types_rcs;
+        int n = 1 + rand_r(&thr_seeds[my_idx]) % max_available_rcs[ri];
+        lt_lock_rcs(&locks, ri);
+        request[my_idx][ri] = n;
+        lt_unlock_rcs(&locks, ri);
+        acquire_rcs(my_idx, ri, n);
+        release_all_rcs(my_idx);
+        ops += 1;
+    }
+    bench_ops[my_idx] = ops;
+    return NULL;
+}
+
+void* bench_detector(void *dummy){
+    int thr_in_dlock[max_threads];
+    struct timespec pause = {0, 1000000};
+    while(!bench_stop){
+        dlock_state st = detection_begin();
+        check_dlock_state(&st, thr_in_dlock);
+        detection_end();
+        nanosleep(&pause, NULL);
+    }
+    return NULL;
+}
+
+double bench_run(lock_mode_t mode, snapshot_mode_t snap, int n_thr, int n_rcs, double seconds){
+    max_threads = n_thr;
+    snapshot_mode = snap;
+    total_types_rcs = n_rcs;
+    max_available_rcs = (int *)malloc(sizeof(int) * n_rcs);
+    available_rcs = (int *)malloc(sizeof(int) * n_rcs);
+    for(int i = 0; i < n_rcs; i++){
+        max_available_rcs[i] = available_rcs[i] = 8;
+    }
+    ss_init_ex(&store, n_thr, n_rcs, false, false, true);
+    allocation = store.allocation;
+    request = store.request;
+    cur_request = store.cur_request;
+    lt_init(&locks, mode, &mutex, n_rcs, n_thr);
+    seq_init(&seqs, n_rcs, n_thr);
+    rcs_queues = (wait_queue *)malloc(sizeof(wait_queue) * n_rcs);
+    waiters = (wq_waiter *)malloc(sizeof(wq_waiter) * n_thr);
+    thr_seeds = (unsigned int *)malloc(sizeof(unsigned int) * n_thr);
+    bench_ops = (long *)calloc(n_thr, sizeof(long));
+    int *ids = (int *)malloc(sizeof(int) * n_thr);
+    pthread_t *tids = (pthread_t *)malloc(sizeof(pthread_t) * n_thr);
+    for(int i = 0; i < n_rcs; i++){
+        wq_init(&rcs_queues[i]);
+    }
+    for(int i = 0; i < n_thr; i++){
+        wq_waiter_init(&waiters[i], i);
+        thr_seeds[i] = 1234 + i;
+        ids[i] = i;
+    }
+
+    bench_stop = false;
+    pthread_t det;
+    struct timeval t0, t1;
+    gettimeofday(&t0, NULL);
+    for(int i = 0; i < n_thr; i++){
+        pthread_create(&tids[i], NULL, bench_worker, &ids[i]);
+    }
+    pthread_create(&det, NULL, bench_detector, NULL);
+    struct timespec run = {(time_t)seconds, (long)((seconds - (time_t)seconds) * 1e9)};
+    nanosleep(&run, NULL);
+    bench_stop = true;
+    for(int i = 0; i < n_thr; i++){
+        pthread_join(tids[i], NULL);
+    }
+    pthread_join(det, NULL);
+    gettimeofday(&t1, NULL);
+
+    long total = 0;
+    for(int i = 0; i < n_thr; i++){
+        total += bench_ops[i];
+        wq_waiter_destroy(&waiters[i]);
+    }
+    double elapsed = (t1.tv_sec - t0.tv_sec) + (t1.tv_usec - t0.tv_usec) * 1e-6;
+
+    lt_destroy(&locks);
+    seq_destroy(&seqs);
+    ss_destroy(&store);
+    ss_destroy(&det_snap);
+    free(det_available);
+    det_available = NULL;
+    free(max_available_rcs);
+    free(available_rcs);
+    free(rcs_queues);
+    free(waiters);
+    free(thr_seeds);
+    free(bench_ops);
+    free(ids);
+    free(tids);
+    return total / elapsed;
+}
+
+int main(int argc, char *argv[]){
+    int max_thr = (argc > 1) ? atoi(argv[1]) : 32;
+    int n_rcs = (argc > 2) ? atoi(argv[2]) : 64;
+    double seconds = (argc > 3) ? atof(argv[3]) : 1.0;
+    pthread_mutex_init(&mutex, NULL);
+    printf("mode,threads,resource_types,cycles_per_sec\n");
+    for(int n_thr = 1; n_thr <= max_thr; n_thr *= 2){
+        printf("global,%d,%d,%.0f\n", n_thr, n_rcs, bench_run(LOCK_GLOBAL, SNAP_LOCKED, n_thr, n_rcs, seconds));
+        printf("sharded,%d,%d,%.0f\n", n_thr, n_rcs, bench_run(LOCK_SHARDED, SNAP_LOCKED, n_thr, n_rcs, seconds));
+        printf("sharded_optimistic,%d,%d,%.0f\n", n_thr, n_rcs,
+               bench_run(LOCK_SHARDED, SNAP_OPTIMISTIC, n_thr, n_rcs, seconds));
+        fflush(stdout);
+    }
+    pthread_mutex_destroy(&mutex);
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include "../all_functions.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Conversion of a scenario file to its binary form, with the time taken to load both.
+ * The input, in text or binary form, is written out in binary form, then both files are loaded the given number of
+ * times and the mean time of a load is printed. With -g, a text scenario with the given number of resource types is
+ * first generated into the input file: 64 threads, the first half uniform and the second half given to the zipf profile
+ * by a range, so that the profile table is written as well.
+ *
+ *   gcc -O2 Benchmarks/make_scenario.c -lpthread -o make_scenario
+ *   ./make_scenario [-g resource_types] [-n repeats] input output
+ */
+
+double now_sec(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Function to write a text scenario with n_rcs resource types.
+ * @return Return true on success.
+ */
+bool generate(const char *path, int n_rcs){
+    FILE *f = fopen(path, "w");
+    if(f == NULL)
+        return false;
+    fprintf(f, "# Generated scenario of %d resource types\n", n_rcs);
+    fprintf(f, "threads 64\ninterval 1\nheuristic 1\ntime 10\nseed 42\n");
+    srand(42);
+    for(int i = 0; i < n_rcs; i++){
+        fprintf(f, "resource R%d %d\n", i, 1 + rand() % 16);
+    }
+    fprintf(f, "profile %s 32 63\n", wl_profiles[WL_ZIPF].name);
+    return fclose(f) == 0;
+}
+
+/**
+ * Function to time the load of a scenario file.
+ * @return Return the mean time of a load in seconds, or -1 if the file cannot be loaded.
+ */
+double time_load(const char *path, int repeats){
+    char err[256];
+    scenario sc;
+    double t0 = now_sec();
+    for(int r = 0; r < repeats; r++){
+        if(!sc_load(&sc, path, err, sizeof(err))){
+            printf("%s\n", err);
+            return -1;
+        }
+        sc_free(&sc);
+    }
+    return (now_sec() - t0) / repeats;
+}
+
+int main(int argc, char *argv[]){
+    int n_generate = 0, repeats = 10;
+    int opt;
+    while((opt = getopt(argc, argv, "g:n:")) != -1){
+        switch(opt){
+            case 'g': n_generate = atoi(optarg);
+                      break;
+            case 'n': repeats = atoi(optarg);
+                      break;
+            default: printf("Usage: %s [-g resource_types] [-n repeats] input output\n", argv[0]);
+                     return 1;
+        }
+    }
+    if(argc - optind != 2 || repeats <= 0){
+        printf("Usage: %s [-g resource_types] [-n repeats] input output\n", argv[0]);
+        return 1;
+    }
+    const char *in = argv[optind], *out = argv[optind + 1];
+    if(n_generate > 0 && !generate(in, n_generate)){
+        printf("Failed to write %s\n", in);
+        return 1;
+    }
+    char err[256];
+    scenario sc;
+    if(!sc_load(&sc, in, err, sizeof(err))){
+        printf("%s\n", err);
+        return 1;
+    }
+    if(!sc_write_binary(&sc, out)){
+        printf("Failed to write %s\n", out);
+        return 1;
+    }
+    printf("%d threads, %d resource types\n", sc.n_thr, sc.n_rcs);
+    sc_free(&sc);
+    printf("Load of %s: %lf ms\n", in, 1e3 * time_load(in, repeats));
+    printf("Load of %s: %lf ms\n", out, 1e3 * time_load(out, repeats));
+    return 0;
+}
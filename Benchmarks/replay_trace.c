@@ -0,0 +1,246 @@
+#include "../all_functions.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Offline replay of a trace recorded with -T through the detector.
+ * The state of the run is rebuilt from the records, without any worker thread: request sets and claims set the request
+ * rows, grants and releases move instances between available_rcs and the allocation rows, and terminations resolve the
+ * victim. At every recorded check, check_dlock() runs on the rebuilt state and its outcome is compared with the one of
+ * the run; if a deadlock is found, select_thr_to_cncl() is timed as well and its victim compared with the next recorded
+ * termination. The whole trace is replayed the given number of times, and the mismatches of the first replay, the
+ * records applied per second and the mean time of the checks and of the heuristic are printed.
+ *
+ * The checks only match exactly for traces of the global locking mode with locked snapshots, or of -d; with -o the
+ * detector examines a copy taken without locks, whose position among the records is approximate. Choosing another
+ * heuristic with -h compares the victims of two heuristics on the same states.
+ *
+ *   gcc -O2 Benchmarks/replay_trace.c -lpthread -o replay_trace
+ *   ./replay_trace [-h heuristic] [-n repeats] trace
+ */
+
+/* Trace opened for reading */
+typedef struct {
+    uint8_t *map;
+    size_t len;
+    const tr_header *header;
+    const int32_t *max_available;
+    const tr_record *records;
+    uint64_t n_records;
+} trace_file;
+
+/**
+ * Function to map a trace for reading.
+ * @return Return true if the file is a trace of this version.
+ */
+bool tr_map(trace_file *tf, const char *path){
+    memset(tf, 0, sizeof(*tf));
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return false;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(tr_header)){
+        close(fd);
+        return false;
+    }
+    tf->len = (size_t)st.st_size;
+    tf->map = (uint8_t *)mmap(NULL, tf->len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(tf->map == MAP_FAILED){
+        tf->map = NULL;
+        return false;
+    }
+    tf->header = (const tr_header *)tf->map;
+    if(tf->header->magic != TR_MAGIC || tf->header->version != TR_VERSION ||
+       tf->header->record_size != sizeof(tr_record) || tf->header->data_offset > tf->len)
+        return false;
+    tf->max_available = (const int32_t *)(tf->map + sizeof(tr_header));
+    tf->records = (const tr_record *)(tf->map + tf->header->data_offset);
+    uint64_t n = (tf->len - tf->header->data_offset) / sizeof(tr_record);
+    if(tf->header->n_records > 0 && tf->header->n_records < n)
+        n = tf->header->n_records;
+    for(uint64_t i = 0; tf->header->n_records == 0 && i < n; i++){
+        if(tf->records[i].kind == 0){
+            n = i;  /* Not closed: the records end at the first zero one */
+            break;
+        }
+    }
+    tf->n_records = n;
+    return true;
+}
+
+/**
+ * Function to unmap a trace opened by tr_map().
+ */
+void tr_unmap(trace_file *tf){
+    if(tf->map != NULL)
+        munmap(tf->map, tf->len);
+    tf->map = NULL;
+}
+
+double now_sec(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+typedef struct {
+    long checks, dlocks, victims;
+    long presence_mismatches;   /* Checks where the replayed detector disagrees on whether there is a deadlock */
+    long count_mismatches;  /* Checks where both find a deadlock, but not of the same number of threads */
+    long victim_mismatches; /* Victims of the heuristic differing from the recorded termination */
+    double check_time, select_time;
+} replay_stats;
+
+/**
+ * Function to find the next termination after a record, stopping at the next check.
+ * @return Return the index of the terminated thread, or -1 if there is none.
+ */
+int next_victim(const trace_file *tf, uint64_t from){
+    for(uint64_t k = from; k < tf->n_records; k++){
+        if(tf->records[k].kind == TR_TERMINATE)
+            return tf->records[k].thr;
+        if(tf->records[k].kind == TR_CHECK)
+            break;
+    }
+    return -1;
+}
+
+/**
+ * Function to replay a trace once, from the initial state.
+ */
+void replay(const trace_file *tf, replay_stats *rs, int thr_in_dlock[]){
+    memset(rs, 0, sizeof(*rs));
+    for(int i = 0; i < max_threads; i++){
+        memset(allocation[i], 0, sizeof(int) * total_types_rcs);
+        memset(request[i], 0, sizeof(int) * total_types_rcs);
+        memset(cur_request[i], 0, sizeof(int) * total_types_rcs);
+        as_clear(&astats, i);
+    }
+    memcpy(available_rcs, max_available_rcs, sizeof(int) * total_types_rcs);
+
+    for(uint64_t k = 0; k < tf->n_records; k++){
+        const tr_record *r = &tf->records[k];
+        switch(r->kind){
+            case TR_SET:
+                memset(request[r->thr], 0, sizeof(int) * total_types_rcs);
+                break;
+            case TR_CLAIM:
+                request[r->thr][r->rcs] = r->count;
+                break;
+            case TR_GRANT:
+                cur_request[r->thr][r->rcs] = r->count;
+                grant_rcs(r->thr, r->rcs);
+                break;
+            case TR_RELEASE: {
+                int old = allocation[r->thr][r->rcs];
+                available_rcs[r->rcs] += r->count;
+                allocation[r->thr][r->rcs] -= r->count;
+                as_update(&astats, r->thr, allocation[r->thr], r->rcs, old);
+                break;
+            }
+            case TR_CHECK: {
+                for(int i = 0; i < max_threads; i++){
+                    thr_in_dlock[i] = -1;
+                }
+                double t0 = now_sec();
+                bool is_dlock = check_dlock(thr_in_dlock);
+                rs->check_time += now_sec() - t0;
+                rs->checks += 1;
+                int n = 0;
+                while(n < max_threads && thr_in_dlock[n] != -1)
+                    n++;
+                if(is_dlock != (r->count > 0))
+                    rs->presence_mismatches += 1;
+                else if(is_dlock && n != r->count)
+                    rs->count_mismatches += 1;
+                if(is_dlock){
+                    rs->dlocks += 1;
+                    t0 = now_sec();
+                    int victim = select_thr_to_cncl(thr_in_dlock);
+                    rs->select_time += now_sec() - t0;
+                    int recorded = next_victim(tf, k + 1);
+                    if(recorded != -1 && recorded != victim)
+                        rs->victim_mismatches += 1;
+                }
+                break;
+            }
+            case TR_TERMINATE:
+                resolve_dlock(r->thr);
+                rs->victims += 1;
+                break;
+        }
+    }
+}
+
+int main(int argc, char *argv[]){
+    int opt;
+    int heuristic = 0;
+    int repeats = 1;
+    while((opt = getopt(argc, argv, "h:n:")) != -1){
+        switch(opt){
+            case 'h': heuristic = atoi(optarg);
+                      break;
+            case 'n': repeats = atoi(optarg);
+                      break;
+            default:
+                fprintf(stderr, "Usage: %s [-h heuristic] [-n repeats] trace\n", argv[0]);
+                return 1;
+        }
+    }
+    if(optind >= argc || repeats < 1){
+        fprintf(stderr, "Usage: %s [-h heuristic] [-n repeats] trace\n", argv[0]);
+        return 1;
+    }
+    trace_file tf;
+    if(!tr_map(&tf, argv[optind])){
+        log_msg("Failed to read the trace.", true);
+    }
+    simd_init();
+    max_threads = tf.header->n_thr;
+    total_types_rcs = tf.header->n_rcs;
+    heuristic_no = (heuristic > 0) ? heuristic : tf.header->heuristic;
+    max_available_rcs = (int *)malloc(sizeof(int) * total_types_rcs);
+    available_rcs = (int *)malloc(sizeof(int) * total_types_rcs);
+    int *thr_in_dlock = (int *)malloc(sizeof(int) * max_threads);
+    if(max_available_rcs == NULL || available_rcs == NULL || thr_in_dlock == NULL ||
+       !ss_init_ex(&store, max_threads, total_types_rcs, false, false, true) ||
+       !as_init(&astats, max_threads, total_types_rcs)){
+        log_msg("Failed to allocate the state.", true);
+    }
+    memcpy(max_available_rcs, tf.max_available, sizeof(int) * total_types_rcs);
+    allocation = store.allocation;
+    request = store.request;
+    cur_request = store.cur_request;
+
+    replay_stats first, rs;
+    double t0 = now_sec();
+    replay(&tf, &first, thr_in_dlock);
+    double check_time = first.check_time, select_time = first.select_time;
+    for(int k = 1; k < repeats; k++){
+        replay(&tf, &rs, thr_in_dlock);
+        check_time += rs.check_time;
+        select_time += rs.select_time;
+    }
+    double elapsed = now_sec() - t0;
+
+    printf("Trace: %d threads, %d resource types, heuristic %d, %llu records (%llu dropped)\n", max_threads,
+           total_types_rcs, tf.header->heuristic, (unsigned long long)tf.n_records,
+           (unsigned long long)tf.header->dropped);
+    printf("Checks = %ld, deadlocks = %ld, victims = %ld\n", first.checks, first.dlocks, first.victims);
+    printf("Mismatches: presence = %ld, size = %ld, victim (heuristic %d) = %ld\n", first.presence_mismatches,
+           first.count_mismatches, heuristic_no, first.victim_mismatches);
+    printf("Replayed %d times: %.0f records per sec\n", repeats,
+           (elapsed > 0) ? (double)tf.n_records * repeats / elapsed : 0);
+    printf("Mean time of check_dlock() = %.1f ns, of select_thr_to_cncl() = %.1f ns\n",
+           (first.checks > 0) ? check_time * 1e9 / ((double)first.checks * repeats) : 0,
+           (first.dlocks > 0) ? select_time * 1e9 / ((double)first.dlocks * repeats) : 0);
+
+    ss_destroy(&store);
+    as_destroy(&astats);
+    free(max_available_rcs);
+    free(available_rcs);
+    free(thr_in_dlock);
+    tr_unmap(&tf);
+    return 0;
+}
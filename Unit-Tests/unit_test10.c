@@ -0,0 +1,72 @@
+#include "../all_functions.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(){
+    /* The maintained aggregates must match the rows after any sequence of grants, releases and terminations, and the
+    heuristics must pick the same victim with and without them */
+    simd_init();
+    srand(10);
+    max_threads = 50;
+    total_types_rcs = 7;
+    ss_init_ex(&store, max_threads, total_types_rcs, false, false, true);
+    allocation = store.allocation;
+    request = store.request;
+    cur_request = store.cur_request;
+    as_init(&astats, max_threads, total_types_rcs);
+    available_rcs = (int *)calloc(total_types_rcs, sizeof(int));
+    lt_init(&locks, LOCK_GLOBAL, &mutex, total_types_rcs, max_threads);
+    rcs_queues = (wait_queue *)malloc(sizeof(wait_queue) * total_types_rcs);
+    waiters = (wq_waiter *)malloc(sizeof(wq_waiter) * max_threads);
+    for(int i = 0; i < total_types_rcs; i++){
+        wq_init(&rcs_queues[i]);
+    }
+    for(int i = 0; i < max_threads; i++){
+        wq_waiter_init(&waiters[i], i);
+    }
+    bool passed = true;
+    for(int step = 0; step < 20000 && passed; step++){
+        int t = rand() % max_threads, ri = rand() % total_types_rcs;
+        switch(rand() % 8){
+            case 0: release_all_rcs(t);
+                    break;
+            case 1: resolve_dlock(t);
+                    break;
+            default: request[t][ri] = cur_request[t][ri] = 1 + rand() % 5;
+                     grant_rcs(t, ri);
+                     break;
+        }
+        if(astats.total[t] != row_sum(allocation[t], total_types_rcs) ||
+           astats.max[t] != row_max(allocation[t], total_types_rcs) ||
+           astats.min[t] != row_min(allocation[t], total_types_rcs)){
+            passed = false;
+        }
+        if(step % 100 == 0){
+            int thr_in_dlock[max_threads];
+            int k = 0;
+            for(int i = 0; i < max_threads; i++){
+                if(rand() % 4 == 0)
+                    thr_in_dlock[k++] = i;
+            }
+            for(int i = k; i < max_threads; i++){
+                thr_in_dlock[i] = -1;
+            }
+            if(k == 0)
+                continue;
+            for(heuristic_no = 1; heuristic_no <= 5; heuristic_no++){
+                int with_stats = select_thr_to_cncl(thr_in_dlock);
+                alloc_stats saved = astats;
+                astats.total = NULL;
+                int from_rows = select_thr_to_cncl(thr_in_dlock);
+                astats = saved;
+                if(with_stats != from_rows)
+                    passed = false;
+            }
+        }
+    }
+    if(passed){
+        printf("Test #10 passed\n");
+    }else{
+        printf("Test #10 failed\n");
+    }
+}
@@ -0,0 +1,62 @@
+#include "../all_functions.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* The victims chosen in one step must resolve every deadlock, and none of them may be spared */
+int main(){
+    simd_init();
+    srand(11);
+    bool passed = true;
+    int tested = 0;
+    for(int trial = 0; trial < 300 && passed; trial++){
+        max_threads = 2 + rand() % 60;
+        total_types_rcs = 1 + rand() % 6;
+        heuristic_no = 1 + trial % 5;
+        allocation = (int **)malloc(max_threads * sizeof(int *));
+        request = (int **)malloc(max_threads * sizeof(int *));
+        available_rcs = (int *)malloc(total_types_rcs * sizeof(int));
+        for(int i = 0; i < max_threads; i++){
+            allocation[i] = (int *)malloc(total_types_rcs * sizeof(int));
+            request[i] = (int *)malloc(total_types_rcs * sizeof(int));
+            for(int j = 0; j < total_types_rcs; j++){
+                allocation[i][j] = (rand() % 2 == 0) ? rand() % 4 : 0;
+                request[i][j] = (rand() % 3 == 0) ? 1 + rand() % 5 : 0;
+            }
+        }
+        for(int j = 0; j < total_types_rcs; j++){
+            available_rcs[j] = rand() % 2;
+        }
+
+        dlock_state st = {allocation, request, available_rcs};
+        int work[total_types_rcs], thr_in_dlock[max_threads], victims[max_threads], scratch[max_threads];
+        int trial_work[total_types_rcs];
+        bool finish[max_threads], trial_finish[max_threads];
+        for(int i = 0; i < max_threads; i++){
+            thr_in_dlock[i] = scratch[i] = -1;
+        }
+        reduction_init(&st, work, finish);
+        if(reduce_dlock(&st, work, finish, false, thr_in_dlock)){
+            tested += 1;
+            int n = select_victims(&st, work, finish, thr_in_dlock, victims);
+            if(n < 1 || !victims_resolve(&st, work, finish, victims, n, -1, trial_work, trial_finish, scratch))
+                passed = false;
+            for(int i = 0; i < n && n > 1; i++){
+                if(victims_resolve(&st, work, finish, victims, n, i, trial_work, trial_finish, scratch))
+                    passed = false;
+            }
+        }
+
+        for(int i = 0; i < max_threads; i++){
+            free(allocation[i]);
+            free(request[i]);
+        }
+        free(allocation);
+        free(request);
+        free(available_rcs);
+    }
+    if(passed && tested > 0){
+        printf("Test #11 passed\n");
+    }else{
+        printf("Test #11 failed\n");
+    }
+}
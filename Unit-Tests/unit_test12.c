@@ -0,0 +1,75 @@
+#include "../all_functions.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* The safety check of the Banker's algorithm must agree with a full check of the state after the grant, from any safe
+state, and must leave the state unchanged */
+int main(){
+    simd_init();
+    srand(12);
+    bool passed = true;
+    int tested = 0;
+    for(int trial = 0; trial < 2000 && passed; trial++){
+        max_threads = 1 + rand() % 30;
+        total_types_rcs = 1 + rand() % 5;
+        allocation = (int **)malloc(max_threads * sizeof(int *));
+        request = (int **)malloc(max_threads * sizeof(int *));
+        cur_request = (int **)malloc(max_threads * sizeof(int *));
+        available_rcs = (int *)malloc(total_types_rcs * sizeof(int));
+        safety_work = (int *)malloc(total_types_rcs * sizeof(int));
+        safety_finish = (bool *)malloc(max_threads * sizeof(bool));
+        safety_left = (int *)malloc(max_threads * sizeof(int));
+        for(int i = 0; i < max_threads; i++){
+            allocation[i] = (int *)malloc(total_types_rcs * sizeof(int));
+            request[i] = (int *)malloc(total_types_rcs * sizeof(int));
+            cur_request[i] = (int *)calloc(total_types_rcs, sizeof(int));
+            for(int j = 0; j < total_types_rcs; j++){
+                allocation[i][j] = (rand() % 2 == 0) ? rand() % 3 : 0;
+                request[i][j] = (rand() % 2 == 0) ? rand() % 5 : 0;
+            }
+        }
+        for(int j = 0; j < total_types_rcs; j++){
+            available_rcs[j] = rand() % 4;
+        }
+        int scratch[max_threads];
+        for(int i = 0; i < max_threads; i++){
+            scratch[i] = -1;
+        }
+        int t = rand() % max_threads, ri = rand() % total_types_rcs;
+        int n = (request[t][ri] < available_rcs[ri]) ? request[t][ri] : available_rcs[ri];
+        if(!check_dlock(scratch) && n > 0){
+            tested += 1;
+            cur_request[t][ri] = n;
+            int avail = available_rcs[ri], alloc = allocation[t][ri], req = request[t][ri];
+            bool safe = grant_is_safe(t, ri);
+            if(available_rcs[ri] != avail || allocation[t][ri] != alloc || request[t][ri] != req)
+                passed = false;
+            available_rcs[ri] -= n;
+            allocation[t][ri] += n;
+            request[t][ri] -= n;
+            for(int i = 0; i < max_threads; i++){
+                scratch[i] = -1;
+            }
+            if(safe == check_dlock(scratch))
+                passed = false;
+        }
+
+        for(int i = 0; i < max_threads; i++){
+            free(allocation[i]);
+            free(request[i]);
+            free(cur_request[i]);
+        }
+        free(allocation);
+        free(request);
+        free(cur_request);
+        free(available_rcs);
+        free(safety_work);
+        free(safety_finish);
+        free(safety_left);
+    }
+    if(passed && tested > 0){
+        printf("Test #12 passed\n");
+    }else{
+        printf("Test #12 failed\n");
+    }
+}
@@ -0,0 +1,41 @@
+#include "../all_functions.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Every value of a histogram must fall in a bucket whose upper bound is at most 25% above it, the buckets must be
+ordered as the values, and the quantiles must come from the right bucket */
+int main(){
+    bool passed = true;
+    unsigned int s = 13;
+    int last = -1;
+    for(uint64_t v = 0; v < 100000 && passed; v++){
+        int b = mt_bucket(v);
+        if(b < last || b >= MT_BUCKETS || mt_bucket_high(b) < v || mt_bucket_high(b) > v + v / 4)
+            passed = false;
+        last = b;
+    }
+    for(int k = 0; k < 100000 && passed; k++){
+        uint64_t v = ((uint64_t)rand_r(&s) << 33) ^ ((uint64_t)rand_r(&s) << 2) ^ (uint64_t)rand_r(&s);
+        int b = mt_bucket(v);
+        if(b >= MT_BUCKETS || mt_bucket_high(b) < v || mt_bucket_high(b) - v > v / 4)
+            passed = false;
+    }
+    if(mt_bucket(UINT64_MAX) != MT_BUCKETS - 1 || mt_bucket_high(MT_BUCKETS - 1) != UINT64_MAX)
+        passed = false;
+
+    metrics m;
+    mt_init(&m, 3, "/tmp/unit_test13", 1, sim_now);
+    for(int i = 1; i <= 1000; i++){
+        mt_value(&m, i % 3, MH_CHECK, (uint64_t)i * 1000);
+    }
+    mt_merged mh;
+    mt_merge(&m, MH_CHECK, &mh);
+    uint64_t p50 = mt_quantile(&mh, 0.5), p99 = mt_quantile(&mh, 0.99);
+    if(mh.count != 1000 || mh.max != 1000000 || p50 < 500000 || p50 > 625000 || p99 < 990000 || p99 > 1000000)
+        passed = false;
+    if(passed){
+        printf("Test #13 passed\n");
+    }else{
+        printf("Test #13 failed\n");
+    }
+}
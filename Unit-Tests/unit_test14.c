@@ -0,0 +1,114 @@
+#include "../all_functions.h"
+#include "../libdlock/dlock.c"
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(){
+    /* The library must find the same deadlocks and terminate the same victims as the simulator's detector on the same
+    states, and two detectors must not share any state */
+    simd_init();
+    srand(14);
+    bool passed = true;
+    for(int trial = 0; trial < 200 && passed; trial++){
+        max_threads = 2 + rand() % 40;
+        total_types_rcs = 1 + rand() % 6;
+        heuristic_no = 1 + trial % 5;
+        int max_avail[total_types_rcs];
+        for(int j = 0; j < total_types_rcs; j++){
+            max_avail[j] = 1 + rand() % 8;
+        }
+        dlock_ctx *ctx = dlock_create(max_threads, total_types_rcs, max_avail, heuristic_no);
+        dlock_ctx *other = dlock_create(max_threads, total_types_rcs, max_avail, heuristic_no);
+        ss_init_ex(&store, max_threads, total_types_rcs, false, false, true);
+        allocation = store.allocation;
+        request = store.request;
+        available_rcs = (int *)malloc(total_types_rcs * sizeof(int));
+        memcpy(available_rcs, max_avail, sizeof(int) * total_types_rcs);
+        for(int i = 0; i < max_threads; i++){
+            if(dlock_register_thread(ctx) != i || dlock_register_thread(other) != i)
+                passed = false;
+        }
+        if(dlock_register_thread(ctx) != DLOCK_EFULL)
+            passed = false;
+
+        /* Granting random instances, then making every thread wait for more */
+        for(int step = 0; step < 4 * max_threads; step++){
+            int t = rand() % max_threads, j = rand() % total_types_rcs, n = 1 + rand() % 3;
+            int expect = (n <= available_rcs[j]) ? 0 : DLOCK_EAGAIN;
+            if(dlock_grant(ctx, t, j, n) != expect)
+                passed = false;
+            if(expect == 0){
+                available_rcs[j] -= n;
+                allocation[t][j] += n;
+            }
+        }
+        for(int i = 0; i < max_threads; i++){
+            int j = rand() % total_types_rcs, n = rand() % 4;
+            dlock_request(ctx, i, j, n);
+            request[i][j] += n;
+        }
+
+        int expected[max_threads], found[max_threads];
+        for(int i = 0; i < max_threads; i++){
+            expected[i] = -1;
+        }
+        check_dlock(expected);
+        int k_expected = 0;
+        while(k_expected < max_threads && expected[k_expected] != -1)
+            k_expected++;
+        int k = dlock_detect(ctx, found);
+        if(k != k_expected || memcmp(found, expected, sizeof(int) * k) != 0)
+            passed = false;
+        if(dlock_detect(other, NULL) != 0)
+            passed = false;
+
+        /* Resolving with the simulator's loop: one victim of the heuristic at a time */
+        int victims[max_threads], n_expected = 0, expected_victims[max_threads];
+        while(k_expected > 0){
+            int v = select_thr_to_cncl(expected);
+            expected_victims[n_expected++] = v;
+            row_add(available_rcs, allocation[v], total_types_rcs);
+            memset(allocation[v], 0, sizeof(int) * total_types_rcs);
+            memset(request[v], 0, sizeof(int) * total_types_rcs);
+            for(int i = 0; i < max_threads; i++){
+                expected[i] = -1;
+            }
+            check_dlock(expected);
+            k_expected = 0;
+            while(k_expected < max_threads && expected[k_expected] != -1)
+                k_expected++;
+        }
+        int n = dlock_resolve(ctx, victims);
+        if(n != n_expected || memcmp(victims, expected_victims, sizeof(int) * n) != 0)
+            passed = false;
+        if(dlock_detect(ctx, NULL) != 0)
+            passed = false;
+        for(int j = 0; j < total_types_rcs; j++){
+            if(dlock_available(ctx, j) != available_rcs[j] || dlock_available(other, j) != max_avail[j])
+                passed = false;
+        }
+
+        /* Unregistering every thread gives every instance back */
+        for(int i = 0; i < max_threads; i++){
+            if(dlock_unregister_thread(ctx, i) != 0)
+                passed = false;
+        }
+        for(int j = 0; j < total_types_rcs; j++){
+            if(dlock_available(ctx, j) != max_avail[j])
+                passed = false;
+        }
+        if(dlock_grant(ctx, 0, 0, 1) != DLOCK_EINVAL)
+            passed = false;
+
+        dlock_destroy(ctx);
+        dlock_destroy(other);
+        ss_destroy(&store);
+        free(available_rcs);
+    }
+    if(passed){
+        printf("Test #14 passed\n");
+    }else{
+        printf("Test #14 failed\n");
+    }
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include "../all_functions.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* A text scenario must give the same parameters, resource types and profiles as its binary form, and files that are
+not scenarios must be rejected */
+int main(){
+    bool passed = true;
+    char err[256];
+    FILE *f = fopen("/tmp/unit_test15.txt", "w");
+    fprintf(f, "# Scenario\nthreads 6\ninterval 2\nheuristic 3\ntime 7\nseed 99\n\nresource A 10   # first\n");
+    fprintf(f, "resource Bb 1\nresource C 0\nprofile uniform\nprofile uniform 2 4\n");
+    fclose(f);
+
+    scenario text, bin;
+    if(!sc_load(&text, "/tmp/unit_test15.txt", err, sizeof(err)))
+        passed = false;
+    if(passed && (text.n_thr != 6 || text.interval != 2 || text.heuristic != 3 || text.exec_time != 7 ||
+                  text.seed != 99 || text.n_rcs != 3 || strcmp(text.names[1], "Bb") != 0 ||
+                  text.max_available[0] != 10 || text.max_available[2] != 0 || text.profiles == NULL))
+        passed = false;
+    if(passed && (!sc_write_binary(&text, "/tmp/unit_test15.bin") ||
+                  !sc_load(&bin, "/tmp/unit_test15.bin", err, sizeof(err))))
+        passed = false;
+    if(passed){
+        if(bin.map == NULL || bin.n_thr != text.n_thr || bin.interval != text.interval ||
+           bin.heuristic != text.heuristic || bin.exec_time != text.exec_time || bin.seed != text.seed ||
+           bin.n_rcs != text.n_rcs || bin.profiles == NULL ||
+           memcmp(bin.max_available, text.max_available, sizeof(int) * text.n_rcs) != 0 ||
+           memcmp(bin.profiles, text.profiles, text.n_thr) != 0)
+            passed = false;
+        for(int i = 0; passed && i < text.n_rcs; i++){
+            if(strcmp(bin.names[i], text.names[i]) != 0)
+                passed = false;
+        }
+        sc_free(&bin);
+    }
+    sc_free(&text);
+
+    /* Unknown directives and profiles, threads out of range, negative instances and a cut binary file */
+    const char *bad[] = {"threads 4\nfoo 1\n", "threads 4\nprofile hungry\n", "threads 4\nprofile uniform 2 9\n",
+                         "resource A 1\n", "threads 4\nresource A\n", "threads 4\nresource A -5\n"};
+    for(int k = 0; k < 6; k++){
+        f = fopen("/tmp/unit_test15.txt", "w");
+        fputs(bad[k], f);
+        fclose(f);
+        if(sc_load(&text, "/tmp/unit_test15.txt", err, sizeof(err)))
+            passed = false;
+    }
+    /* Offsets of a binary header that wrap around when added to the size of their table */
+    sc_header h;
+    f = fopen("/tmp/unit_test15.bin", "r+b");
+    if(f == NULL || fread(&h, sizeof(h), 1, f) != 1)
+        passed = false;
+    for(int k = 0; f != NULL && k < 3; k++){
+        sc_header crafted = h;
+        if(k == 0)
+            crafted.counts_off = UINT64_MAX - 3;
+        else if(k == 1)
+            crafted.pool_off = UINT64_MAX - crafted.pool_len + 2;
+        else
+            crafted.profiles_off = UINT64_MAX - 1;
+        rewind(f);
+        fwrite(&crafted, sizeof(crafted), 1, f);
+        fflush(f);
+        if(sc_load(&bin, "/tmp/unit_test15.bin", err, sizeof(err))){
+            sc_free(&bin);
+            passed = false;
+        }
+    }
+    if(f != NULL){
+        /* A negative number of instances */
+        int32_t minus = -5;
+        rewind(f);
+        fwrite(&h, sizeof(h), 1, f);
+        fseek(f, (long)h.counts_off, SEEK_SET);
+        fwrite(&minus, sizeof(minus), 1, f);
+        fclose(f);
+        if(sc_load(&bin, "/tmp/unit_test15.bin", err, sizeof(err))){
+            sc_free(&bin);
+            passed = false;
+        }
+    }
+    if(truncate("/tmp/unit_test15.bin", sizeof(sc_header) + 4) != 0 ||
+       sc_load(&bin, "/tmp/unit_test15.bin", err, sizeof(err)))
+        passed = false;
+
+    char *args[] = {"5", "1", "2", "3", "4", "2", "X", "3", "Y", "4"};
+    if(!sc_from_args(&text, 10, args) || text.n_thr != 5 || text.n_rcs != 2 || strcmp(text.names[1], "Y") != 0 ||
+       text.max_available[1] != 4 || text.profiles != NULL)
+        passed = false;
+    sc_free(&text);
+    if(sc_from_args(&text, 9, args))
+        passed = false;
+    remove("/tmp/unit_test15.txt");
+    remove("/tmp/unit_test15.bin");
+    if(passed){
+        printf("Test #15 passed\n");
+    }else{
+        printf("Test #15 failed\n");
+    }
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include "../all_functions.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Every workload profile must claim no more than the instances of every resource type, within its own bounds, pick
+only incomplete resource types, and draw the same sets from the same seed; zipf must favour the first resource types */
+int main(){
+    bool passed = true;
+    int n_rcs = 8;
+    int max_avail[8] = {10, 8, 1, 0, 12, 5, 7, 3};
+    wl_init(n_rcs);
+    if(wl_find("zipf") != WL_ZIPF || wl_find("none") != -1)
+        passed = false;
+    for(int p = 0; p < WL_N_PROFILES && passed; p++){
+        const wl_profile *wl = &wl_profiles[p];
+        unsigned int s1 = 16 + p;
+        long hits_first = 0, hits_last = 0;
+        for(int k = 0; k < 2000 && passed; k++){
+            int row[8], again[8];
+            unsigned int s2 = s1;
+            wl->request_set(row, n_rcs, max_avail, &s1);
+            wl->request_set(again, n_rcs, max_avail, &s2);
+            if(memcmp(row, again, sizeof(row)) != 0 || s1 != s2)
+                passed = false;
+            for(int i = 0; i < n_rcs; i++){
+                if(row[i] < 0 || row[i] > max_avail[i] || (p == WL_SMALL && row[i] > max_avail[i] / 4) ||
+                   (p == WL_GREEDY && row[i] != max_avail[i]))
+                    passed = false;
+            }
+            hits_first += (row[0] > 0);
+            hits_last += (row[n_rcs - 1] > 0);
+
+            bool acq[8];
+            for(int i = 0; i < n_rcs; i++){
+                acq[i] = (rand_r(&s1) % 2 == 0);
+            }
+            acq[k % n_rcs] = false;
+            int r = wl->next_rcs(acq, n_rcs, &s1);
+            if(r < 0 || r >= n_rcs || acq[r])
+                passed = false;
+            if(p == WL_ORDERED){
+                for(int i = 0; i < r; i++){
+                    if(!acq[i])
+                        passed = false;
+                }
+            }
+            double pause = wl->pause(&s1), hold = wl->hold(2, k, &s1);
+            if(pause < 0 || pause > 1 || hold < 0 || hold > 2 * 1.5 + 4 * 2)
+                passed = false;
+        }
+        if(p == WL_ZIPF && hits_first < 4 * hits_last)
+            passed = false;
+        if(p == WL_BURSTY){
+            /* The last set of a burst is followed by an idle gap */
+            unsigned int s = 3;
+            if(wl->hold(1, WL_BURST - 1, &s) < 2 || wl->hold(1, 0, &s) > 0.3)
+                passed = false;
+        }
+    }
+    wl_destroy();
+    if(passed){
+        printf("Test #16 passed\n");
+    }else{
+        printf("Test #16 failed\n");
+    }
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include "../all_functions.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Random changes to a sparse state, each bumping the counters of the rows or columns it writes: after every change,
+reducing only the components the partition finds changed must leave the same threads in deadlock as a full reduction,
+and resolving them must leave components the next pass may skip */
+int n_thr, n_rcs;
+int **alloc_m, **req_m, *avail;
+unsigned int *counters; /* Columns, then rows */
+
+void bump_col(int j){
+    counters[j] += 2;
+}
+
+void bump_row(int t){
+    counters[n_rcs + t] += 2;
+}
+
+int main(){
+    simd_init();
+    srand(17);
+    bool passed = true;
+    long skipped = 0;
+    arena scratch;
+    ar_init(&scratch);
+    for(int trial = 0; trial < 100 && passed; trial++){
+        n_thr = 2 + rand() % 40;
+        n_rcs = 1 + rand() % 12;
+        state_store ss;
+        ss_init_ex(&ss, n_thr, n_rcs, false, false, true);
+        alloc_m = ss.allocation;
+        req_m = ss.request;
+        avail = (int *)malloc(sizeof(int) * n_rcs);
+        counters = (unsigned int *)calloc(n_rcs + n_thr, sizeof(unsigned int));
+        for(int j = 0; j < n_rcs; j++){
+            avail[j] = 1 + rand() % 4;
+        }
+        partition pt;
+        pt_init(&pt, n_thr, n_rcs);
+        int work[n_rcs], full_work[n_rcs];
+        bool finish[n_thr], full_finish[n_thr];
+
+        for(int step = 0; step < 200 && passed; step++){
+            int t = rand() % n_thr, j = rand() % n_rcs;
+            switch(rand() % 4){
+                case 0: /* A new request on a few resource types */
+                    for(int k = 0; k < 1 + rand() % 2; k++){
+                        req_m[t][rand() % n_rcs] += 1 + rand() % 2;
+                    }
+                    bump_row(t);
+                    break;
+                case 1: /* A grant */
+                    if(req_m[t][j] > 0 && avail[j] > 0){
+                        int n = (req_m[t][j] < avail[j]) ? req_m[t][j] : avail[j];
+                        alloc_m[t][j] += n;
+                        req_m[t][j] -= n;
+                        avail[j] -= n;
+                        bump_col(j);
+                    }
+                    break;
+                case 2: /* A release of one resource type */
+                    if(alloc_m[t][j] > 0){
+                        avail[j] += alloc_m[t][j];
+                        alloc_m[t][j] = 0;
+                        bump_col(j);
+                    }
+                    break;
+                case 3: /* Nothing: a check with no change */
+                    break;
+            }
+
+            memcpy(full_work, avail, sizeof(work));
+            for(int i = 0; i < n_thr; i++){
+                full_finish[i] = (row_max(alloc_m[i], n_rcs) <= 0);
+            }
+            worklist_reduce(n_thr, n_rcs, alloc_m, req_m, NULL, 0, full_work, full_finish, &scratch);
+
+            pt_observe(&pt, counters);
+            long skipped_before = pt.skipped;
+            memcpy(work, avail, sizeof(work));
+            pt_plan(&pt, alloc_m, req_m, finish);
+            worklist_reduce(n_thr, n_rcs, alloc_m, req_m, NULL, 0, work, finish, &scratch);
+            if(memcmp(finish, full_finish, sizeof(finish)) != 0)
+                passed = false;
+            skipped += pt.skipped - skipped_before;
+
+            /* Resolving: the deadlocked threads give everything back and wait for nothing */
+            for(int i = 0; i < n_thr; i++){
+                if(finish[i])
+                    continue;
+                for(int r = 0; r < n_rcs; r++){
+                    if(alloc_m[i][r] > 0){
+                        avail[r] += alloc_m[i][r];
+                        bump_col(r);
+                    }
+                    alloc_m[i][r] = req_m[i][r] = 0;
+                }
+                bump_row(i);
+                finish[i] = true;
+            }
+            pt_commit(&pt, finish);
+        }
+        pt_destroy(&pt);
+        ss_destroy(&ss);
+        free(avail);
+        free(counters);
+    }
+    ar_destroy(&scratch);
+    if(skipped == 0)
+        passed = false;
+    if(passed){
+        printf("Test #17 passed\n");
+    }else{
+        printf("Test #17 failed\n");
+    }
+    return 0;
+}
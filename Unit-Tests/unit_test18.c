@@ -0,0 +1,131 @@
+#include "../all_functions.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Randomized equivalence of the wait-for graph and the matrix reduction on single-instance resources: a thread that
+blocks closes a cycle only if it is deadlocked, the graph has a cycle exactly when the reduction finds a deadlock, the
+cycle taken is made of deadlocked threads that wait on each other, and once every cycle is broken by terminations the
+roots are all discarded */
+wait_for_graph g;
+
+/**
+ * Function to give resource type r to the first thread blocked on it, if any, as a release wakes its waiter.
+ */
+void hand_over(int r){
+    for(int w = 0; w < max_threads; w++){
+        if(g.blocked_on[w] == r){
+            wfg_unblock(&g, w);
+            request[w][r] = 0;
+            allocation[w][r] = 1;
+            wfg_grant(&g, w, r);
+            return;
+        }
+    }
+    available_rcs[r] = 1;
+}
+
+/**
+ * Function to release every resource type held by a thread, and drop its request.
+ */
+void release_all(int t){
+    for(int r = 0; r < total_types_rcs; r++){
+        request[t][r] = 0;
+    }
+    wfg_unblock(&g, t);
+    for(int r = 0; r < total_types_rcs; r++){
+        if(allocation[t][r] != 0){
+            allocation[t][r] = 0;
+            wfg_release(&g, t, r);
+            hand_over(r);
+        }
+    }
+}
+
+int main(){
+    simd_init();
+    srand(18);
+    bool passed = true;
+    long cycles = 0;
+    for(int trial = 0; trial < 100 && passed; trial++){
+        max_threads = 2 + rand() % 30;
+        total_types_rcs = 1 + rand() % 20;
+        ss_init_ex(&store, max_threads, total_types_rcs, false, false, true);
+        allocation = store.allocation;
+        request = store.request;
+        available_rcs = (int *)malloc(sizeof(int) * total_types_rcs);
+        for(int r = 0; r < total_types_rcs; r++){
+            available_rcs[r] = 1;
+        }
+        wfg_init(&g, max_threads, total_types_rcs);
+        int dlocked[max_threads], members[max_threads];
+
+        for(int step = 0; step < 300 && passed; step++){
+            int t = rand() % max_threads, r = rand() % total_types_rcs;
+            if(g.blocked_on[t] >= 0)
+                continue;   /* A blocked thread does nothing until it is woken */
+            bool closed = false;
+            if(rand() % 5 == 0){
+                release_all(t);     /* Its request set is complete */
+            }else if(allocation[t][r] != 0){
+                continue;
+            }else if(available_rcs[r] > 0){
+                available_rcs[r] = 0;
+                allocation[t][r] = 1;
+                wfg_grant(&g, t, r);
+            }else{
+                request[t][r] = 1;
+                closed = wfg_block(&g, t, r);
+            }
+
+            for(int i = 0; i < max_threads; i++){
+                dlocked[i] = -1;
+            }
+            bool is_dlock = check_dlock(dlocked);
+            if(closed){
+                /* The thread that closed a cycle is deadlocked */
+                bool found = false;
+                for(int i = 0; i < max_threads && dlocked[i] != -1; i++){
+                    found = found || (dlocked[i] == t);
+                }
+                if(!found)
+                    passed = false;
+            }
+
+            int k;
+            while((k = wfg_take_cycle(&g, members)) > 0){
+                cycles += 1;
+                for(int m = 0; m < k; m++){
+                    /* Every member is deadlocked and waits on a resource type held by the next member of the cycle */
+                    bool found = false;
+                    for(int i = 0; i < max_threads && dlocked[i] != -1; i++){
+                        found = found || (dlocked[i] == members[m]);
+                    }
+                    int on = g.blocked_on[members[m]];
+                    if(!found || on < 0 || g.holder[on] < 0 || request[members[m]][on] == 0)
+                        passed = false;
+                }
+                if(!is_dlock)
+                    passed = false;
+                release_all(members[rand() % k]);   /* Terminating a victim */
+                for(int i = 0; i < max_threads; i++){
+                    dlocked[i] = -1;
+                }
+                is_dlock = check_dlock(dlocked);
+            }
+            /* No cycle left: no deadlock, and no root left for the detector */
+            if(is_dlock || wfg_pending(&g))
+                passed = false;
+        }
+        wfg_destroy(&g);
+        ss_destroy(&store);
+        free(available_rcs);
+    }
+    if(cycles == 0)
+        passed = false;
+    if(passed){
+        printf("Test #18 passed\n");
+    }else{
+        printf("Test #18 failed\n");
+    }
+    return 0;
+}
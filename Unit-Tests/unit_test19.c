@@ -0,0 +1,76 @@
+#include "../all_functions.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Randomized equivalence of the resumed reduction and a fresh check: after every victim, continuing the reduction with
+the victim's released instances must leave the same threads in deadlock as check_dlock() on the state after the
+termination */
+int main(){
+    simd_init();
+    srand(19);
+    bool passed = true;
+    long victims = 0;
+    for(int trial = 0; trial < 200 && passed; trial++){
+        max_threads = 1 + rand() % 300;
+        heuristic_no = 1 + trial % 5;
+        total_types_rcs = 1 + rand() % 12;
+        allocation = (int **)malloc(max_threads * sizeof(int *));
+        request = (int **)malloc(max_threads * sizeof(int *));
+        available_rcs = (int *)malloc(total_types_rcs * sizeof(int));
+        int sparsity = 1 + rand() % 8;    /* From mostly deadlocked to mostly free states */
+        for(int i = 0; i < max_threads; i++){
+            allocation[i] = (int *)malloc(total_types_rcs * sizeof(int));
+            request[i] = (int *)malloc(total_types_rcs * sizeof(int));
+            for(int j = 0; j < total_types_rcs; j++){
+                allocation[i][j] = (rand() % 3 == 0) ? rand() % 4 : 0;
+                request[i][j] = (rand() % sparsity == 0) ? 1 + rand() % 5 : 0;
+            }
+        }
+        for(int j = 0; j < total_types_rcs; j++){
+            available_rcs[j] = rand() % 3;
+        }
+
+        dlock_state st = {allocation, request, available_rcs};
+        int work[total_types_rcs], resumed[max_threads], fresh[max_threads];
+        bool finish[max_threads];
+        for(int i = 0; i < max_threads; i++){
+            resumed[i] = -1;
+        }
+        reduction_init(&st, work, finish);
+        bool is_dlock = reduce_dlock(&st, work, finish, false, resumed);
+        while(is_dlock && passed){
+            /* Terminating the victim of the heuristic */
+            int v = select_thr_to_cncl_of(allocation, resumed);
+            row_add(work, allocation[v], total_types_rcs);
+            row_add(available_rcs, allocation[v], total_types_rcs);
+            finish[v] = true;
+            for(int j = 0; j < total_types_rcs; j++){
+                allocation[v][j] = request[v][j] = 0;
+            }
+            victims += 1;
+
+            for(int i = 0; i < max_threads; i++){
+                resumed[i] = fresh[i] = -1;
+            }
+            is_dlock = reduce_dlock(&st, work, finish, true, resumed);
+            bool fresh_dlock = check_dlock(fresh);
+            if(is_dlock != fresh_dlock || memcmp(resumed, fresh, sizeof(resumed)) != 0)
+                passed = false;
+        }
+
+        for(int i = 0; i < max_threads; i++){
+            free(allocation[i]);
+            free(request[i]);
+        }
+        free(allocation);
+        free(request);
+        free(available_rcs);
+    }
+    if(victims == 0)
+        passed = false;
+    if(passed){
+        printf("Test #19 passed\n");
+    }else{
+        printf("Test #19 failed\n");
+    }
+}
@@ -0,0 +1,94 @@
+#include "../all_functions.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Many tasks on a few workers, each running a fixed number of times and alternating between sleeping, yielding and
+parking until another task or the main thread submits it again: every task must run exactly that many times, never on
+two workers at once, and the workers left without tasks of their own must steal */
+#define N_TASKS 64
+#define N_WORKERS 3
+#define ROUNDS 12
+
+task_pool pool;
+int runs[N_TASKS];
+int active[N_TASKS];
+int done;
+bool overlap;
+pthread_mutex_t park_lock = PTHREAD_MUTEX_INITIALIZER;
+int parked[N_TASKS];
+int n_parked;
+
+/**
+ * Function to make the first parked task ready, if any.
+ */
+void wake_one(void){
+    int task = -1;
+    pthread_mutex_lock(&park_lock);
+    if(n_parked > 0)
+        task = parked[--n_parked];
+    pthread_mutex_unlock(&park_lock);
+    if(task >= 0)
+        tp_submit(&pool, task);
+}
+
+void run(int task){
+    if(__atomic_exchange_n(&active[task], 1, __ATOMIC_SEQ_CST) != 0)
+        overlap = true;
+    int n = __atomic_add_fetch(&runs[task], 1, __ATOMIC_SEQ_CST);
+    if(task == 0 && n == 1){
+        /* All the other tasks start in the queue of this worker, so the others find them only by stealing */
+        for(int t = 1; t < N_TASKS; t++){
+            tp_submit(&pool, t);
+        }
+    }
+    double until = tp_now() + 2e-5;
+    while(tp_now() < until);
+    if(n == ROUNDS){
+        __atomic_store_n(&active[task], 0, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&done, 1, __ATOMIC_SEQ_CST);
+        return;
+    }
+    switch((task + n) % 3){
+        case 0: /* Sleeping */
+            if(!tp_sleep(&pool, task, 1e-4 * (task % 8)))
+                overlap = true;
+            __atomic_store_n(&active[task], 0, __ATOMIC_SEQ_CST);
+            break;
+        case 1: /* Yielding */
+            __atomic_store_n(&active[task], 0, __ATOMIC_SEQ_CST);
+            tp_submit(&pool, task);
+            break;
+        case 2: /* Parking, after waking another parked task */
+            wake_one();
+            __atomic_store_n(&active[task], 0, __ATOMIC_SEQ_CST);
+            pthread_mutex_lock(&park_lock);
+            parked[n_parked++] = task;
+            pthread_mutex_unlock(&park_lock);
+            break;
+    }
+}
+
+int main(){
+    bool passed = tp_init(&pool, N_WORKERS, N_TASKS, run) && tp_start(&pool);
+    if(passed)
+        tp_submit(&pool, 0);
+    /* The main thread wakes the tasks left parked, as the simulation's releases do */
+    double deadline = tp_now() + 20;
+    while(passed && __atomic_load_n(&done, __ATOMIC_SEQ_CST) < N_TASKS && tp_now() < deadline){
+        wake_one();
+        usleep(200);
+    }
+    usleep(20000);  /* Any extra run would show up by now */
+    for(int t = 0; t < N_TASKS; t++){
+        if(__atomic_load_n(&runs[t], __ATOMIC_SEQ_CST) != ROUNDS)
+            passed = false;
+    }
+    if(overlap || tp_steals(&pool) == 0)
+        passed = false;
+    if(passed){
+        printf("Test #20 passed\n");
+    }else{
+        printf("Test #20 failed\n");
+    }
+    return 0;
+}
@@ -0,0 +1,39 @@
+#include "../all_functions.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(){
+    int alloc_matrix[5][3] = {{0,1,0},
+                              {2,0,0},
+                              {3,0,3},
+                              {2,1,1},
+                              {0,0,2}};
+    int request_matrix[5][3] = {{0,0,0},
+                                {2,0,2},
+                                {0,0,1},
+                                {1,0,0},
+                                {0,0,2}};
+    allocation = (int **)malloc(5 * sizeof(int *));
+    request = (int **)malloc(5 * sizeof(int *));
+    available_rcs = (int *)malloc(3 * sizeof(int));
+    max_threads = 5;
+    total_types_rcs = 3;
+    for (int i = 0; i < 5; i++){
+        allocation[i] = (int*)malloc(3 * sizeof(int));
+        request[i] = (int*)malloc(3 * sizeof(int));
+        for(int j = 0; j < 3; j++){
+            allocation[i][j] = alloc_matrix[i][j];
+            request[i][j] = request_matrix[i][j];
+        }
+    }
+    available_rcs[0] = 0;
+    available_rcs[1] = 0;
+    available_rcs[2] = 0;
+    int thr_in_dlock[5] = {-1,-1,-1,-1,-1};
+    if(check_dlock(thr_in_dlock) && thr_in_dlock[0] == 1 && thr_in_dlock[1] == 2 && thr_in_dlock[2] == 3 &&
+       thr_in_dlock[3] == 4 && thr_in_dlock[4] == -1){
+        printf("Test #7 passed\n");
+    }else{
+        printf("Test #7 failed\n");
+    }
+}
@@ -0,0 +1,32 @@
+#include "../all_functions.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(){
+    /* The dispatched row kernels must agree with the scalar ones for every length, including the vector tails */
+    int a[100] = {0}, b[100] = {0}, c[100] = {0}, d[100] = {0};
+    unsigned int s = 42;
+    bool passed = true;
+    for(int n = 0; n <= 100 && passed; n++){
+        for(int j = 0; j < n; j++){
+            a[j] = rand_r(&s) % 20;
+            b[j] = a[j] + (rand_r(&s) % 30 == 0 ? -1 : rand_r(&s) % 3);
+            c[j] = d[j] = a[j];
+        }
+        row_add(c, b, n);
+        row_add_scalar(d, b, n);
+        for(int j = 0; j < n; j++){
+            if(c[j] != d[j])
+                passed = false;
+        }
+        if(row_le(a, b, n) != row_le_scalar(a, b, n) || row_sum(a, n) != row_sum_scalar(a, n) ||
+           row_max(a, n) != row_max_scalar(a, n) || row_min(a, n) != row_min_scalar(a, n)){
+            passed = false;
+        }
+    }
+    if(passed){
+        printf("Test #8 passed\n");
+    }else{
+        printf("Test #8 failed\n");
+    }
+}
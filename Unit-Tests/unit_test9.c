@@ -0,0 +1,58 @@
+#include "../all_functions.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Randomized equivalence of the parallel and serial deadlock detection */
+int main(){
+    simd_init();
+    srand(9);
+    bool passed = true;
+    for(int trial = 0; trial < 200 && passed; trial++){
+        max_threads = 1 + rand() % 600;
+        total_types_rcs = 1 + rand() % 12;
+        allocation = (int **)malloc(max_threads * sizeof(int *));
+        request = (int **)malloc(max_threads * sizeof(int *));
+        available_rcs = (int *)malloc(total_types_rcs * sizeof(int));
+        int sparsity = 1 + rand() % 8;    /* From mostly deadlocked to mostly free states */
+        for(int i = 0; i < max_threads; i++){
+            allocation[i] = (int *)malloc(total_types_rcs * sizeof(int));
+            request[i] = (int *)malloc(total_types_rcs * sizeof(int));
+            for(int j = 0; j < total_types_rcs; j++){
+                allocation[i][j] = (rand() % 3 == 0) ? rand() % 4 : 0;
+                request[i][j] = (rand() % sparsity == 0) ? 1 + rand() % 5 : 0;
+            }
+        }
+        for(int j = 0; j < total_types_rcs; j++){
+            available_rcs[j] = rand() % 3;
+        }
+
+        int serial[max_threads], parallel[max_threads];
+        for(int i = 0; i < max_threads; i++){
+            serial[i] = parallel[i] = -1;
+        }
+        bool serial_dlock = check_dlock(serial);
+        par_init(&dpool, 2 + trial % 7, 0, total_types_rcs);
+        bool parallel_dlock = check_dlock(parallel);
+        par_destroy(&dpool);
+
+        if(serial_dlock != parallel_dlock)
+            passed = false;
+        for(int i = 0; i < max_threads; i++){
+            if(serial[i] != parallel[i])
+                passed = false;
+        }
+
+        for(int i = 0; i < max_threads; i++){
+            free(allocation[i]);
+            free(request[i]);
+        }
+        free(allocation);
+        free(request);
+        free(available_rcs);
+    }
+    if(passed){
+        printf("Test #9 passed\n");
+    }else{
+        printf("Test #9 failed\n");
+    }
+}
@@ -7,17 +7,42 @@
 #include <limits.h>
 #include <signal.h>
 #include <sys/time.h>
+#include <sys/wait.h>
 #include <string.h>
 
+#include "alloc_stats.h"
+#include "arena.h"
+#include "simd_kernels.h"
+#include "snapshot.h"
+#include "des.h"
+#include "detect_trigger.h"
+#include "event_log.h"
+#include "locking.h"
+#include "metrics.h"
+#include "parallel_dlock.h"
+#include "partition.h"
+#include "state_store.h"
+#include "task_pool.h"
+#include "scenario.h"
+#include "trace.h"
+#include "victim_select.h"
+#include "wait_for_graph.h"
+#include "wait_queue.h"
+#include "workload.h"
+#include "worklist_dlock.h"
+
+scenario scen;  /* Parameters of the simulation, from the command line or a scenario file; owns the tables below */
 int total_types_rcs;    /* Number of types of resources */
 char** resources_name = NULL;   /* List of names of the resources */
 
 int* max_available_rcs = NULL;  /* Stores the maximum number of instances of each resource type */
 int* available_rcs = NULL;  /* Stores the available number of instances of each resource type */
 
+state_store store;  /* Contiguous storage of the allocation, request and cur_request matrices. */
 int** allocation= NULL; /* Matrix of resources allocated to the threads. */
 int** request = NULL;   /* Remaining resources to be further acquired before the thread completes. */
 int** cur_request = NULL;   /* Current request to acquire a certain number of instances of the remaining resources required. */
+alloc_stats astats; /* Per-thread total, largest and smallest allocation, for the victim selection */
 
 int max_threads;    /* Maximum number of threads. */
 int d_check_interval;   /* Deadlock detection interval. */
@@ -31,11 +56,78 @@ pthread_t *worker_thr_ids = NULL;   /* List of thread ids of the worker thrrads.
 pthread_t detector_thr_id;  /* Thread ID of the detector thread. */
 
 pthread_mutex_t mutex;  /* Mutex lock */
-pthread_cond_t cond;    /* Conditional Variable */
+lock_table locks;   /* Locks of the shared state: the global mutex, or one per resource type and per thread row */
+event_log evlog;    /* Asynchronous log of the events; the i-th worker emits on ring i and the detector on ring max_threads */
+wait_queue* rcs_queues = NULL;  /* Per resource type FIFO of the threads waiting for instances of that resource type */
+wq_waiter* waiters = NULL;  /* i-th waiter is used by the i-th thread to wait on a resource queue */
+
+/* State examined by the detector: the live matrices, or a snapshot of them */
+typedef struct {
+    int **allocation;
+    int **request;
+    int *available;
+} dlock_state;
+
+/* How the detector gets the state it examines */
+typedef enum {
+    SNAP_LOCKED = 0,    /* Lock the state: held for the whole pass in LOCK_GLOBAL mode, only while copying otherwise */
+    SNAP_OPTIMISTIC = 1 /* Copy the state without locking it, validated with the sequence counters */
+} snapshot_mode_t;
+
+snapshot_mode_t snapshot_mode = SNAP_LOCKED;
+seq_table seqs; /* Sequence counters of the columns and rows of the state */
+state_store det_snap;   /* Snapshot of the matrices examined by the detector */
+int* det_available = NULL;  /* Snapshot of available_rcs */
+bool det_holds_lock = false;    /* The detector holds the locks of the whole state for the current pass */
+long snap_recopies = 0; /* Number of columns and rows copied again because they changed during an optimistic copy */
+long snap_fallbacks = 0;    /* Number of optimistic copies abandoned for a locked one */
+#define SNAP_MAX_PASSES 8   /* Validation passes of an optimistic copy before falling back to locking */
+#define TRACE_CAPACITY (1 << 26)  /* Records of a trace file; the file is sparse until written */
+
+wait_for_graph wfg;    /* Wait-for graph, used when every resource type has a single instance */
+bool wfg_mode = false;
+par_pool dpool;  /* Helper threads of the parallel deadlock detection, disabled unless set up by main() */
+detect_trigger trigger; /* Decides when the detector runs: periodically, on blocked threads, or adaptively */
+metrics run_metrics;    /* Counters and histograms; the i-th worker records into slot i and the detector into slot max_threads */
+uint64_t det_lock_start = 0;    /* Time at which the detector took the locks of the whole state for its pass */
+trace_log trace;    /* Binary trace of the state changes and of the detector, for replay */
+double trace_start = 0; /* Time at which the trace was started */
+tr_record *det_check_rec = NULL;    /* Trace record of the current check, reserved when the state is taken */
+
+bool compact_state = false;    /* Rows of the matrices padded to 16 bytes instead of cache lines */
+arena det_arena;    /* Temporaries of the detector, instead of arrays on the stack */
+partition parts;    /* Components of the state, when only the changed ones are reduced again */
+bool multi_victim = false;  /* Choose every victim of a deadlock in one step, instead of one per check */
+bool des_mode = false;  /* Discrete-event simulation in virtual time instead of real threads */
+double des_clock = 0;   /* Virtual time of the discrete-event simulation, in seconds */
+bool task_mode = false; /* M:N mode: the workers run as tasks on a pool of threads */
+task_pool tasks;
+
+bool terminating = false;   /* Set by sig_handler(), after which the detector starts no pass */
+bool det_in_pass = false;   /* The detector is in a pass */
 
-struct timeval start_time, end_time; /* Variables to store the start time and the time of occurrence of the last deadlock. */
+double start_time, end_time; /* Variables to store the start time and the time of occurrence of the last deadlock. */
 int total_dlocks = 0;   /* Total number of deadlocks */
 double total_time_btw_dlocks = 0;
+int total_victims = 0;  /* Number of threads terminated */
+long lost_instances = 0;    /* Instances held by the threads when they were terminated */
+double lost_time = 0;   /* Time the terminated threads had spent on their request sets, in seconds */
+double *set_start = NULL;   /* Time at which every thread generated its current request set */
+int *set_count = NULL;  /* Number of request sets every thread generated */
+int *set_done = NULL;   /* Number of request sets every thread completed */
+double *set_time = NULL;    /* Time every thread spent on its completed request sets, in seconds */
+double *set_lost = NULL;    /* Time every thread had spent on its request sets when it was terminated, in seconds */
+int default_profile = WL_UNIFORM;   /* Workload profile of the threads, when the scenario gives none */
+mt_merged set_latency[WL_N_PROFILES];   /* Time to complete the request sets of every profile, in ns */
+
+bool avoidance = false; /* Banker's algorithm: a grant is only made if the resulting state is safe */
+wait_queue unsafe_queue;    /* Threads whose grant would leave an unsafe state, woken by every release */
+long safety_checks = 0; /* Number of grants checked for safety */
+long safety_fast = 0;   /* Number of them found safe without a reduction */
+long unsafe_grants = 0; /* Number of grants delayed because the state would be unsafe */
+int *safety_work = NULL;    /* Scratch memory of the safety check */
+bool *safety_finish = NULL;
+int *safety_left = NULL;
 
 /* Generate a random double from 0 to 1 */
 double random_double(unsigned int *seed){
@@ -47,6 +139,18 @@ double random_double_interval(double a, double b, unsigned int *seed){
     return random_double(seed) * (b - a) + a;
 }
 
+/**
+ * Function to get the current time of the simulation, in seconds: the virtual time in discrete-event mode, the wall-clock
+ * time otherwise.
+ */
+double sim_now(){
+    if (des_mode)
+        return des_clock;
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
 /**
  * Find maximum between two numbers.
  */
@@ -67,32 +171,129 @@ void log_msg(const char *msg, bool terminate) {
     if (terminate) exit(-1); /* failure */
 }
 
+/**
+ * Function to get the workload profile of a thread.
+ */
+int profile_of(int t){
+    return (scen.profiles != NULL) ? scen.profiles[t] : default_profile;
+}
+
+/**
+ * Function to record the time taken to complete a request set.
+ */
+void record_set_latency(int t, double sec){
+    uint64_t ns = (uint64_t)(sec * 1e9);
+    mt_merged *mh = &set_latency[profile_of(t)];
+    __atomic_add_fetch(&mh->hist[mt_bucket(ns)], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&mh->count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&mh->sum, ns, __ATOMIC_RELAXED);
+    if(ns > __atomic_load_n(&mh->max, __ATOMIC_RELAXED))
+        __atomic_store_n(&mh->max, ns, __ATOMIC_RELAXED);
+    mt_value(&run_metrics, t, MH_SET, ns);
+}
+
 /**
  * Function to handle signals SIGALRM and SIGINT.
  * @param signum To differentiate between the type of signal(SIGALRM or SIGINT)
  */
 void sig_handler(int signum){
-    pthread_mutex_lock(&mutex); /* Acquiring the mutex lock */
+    /* Waiting for the detector to leave its pass, which may read the state without any lock */
+    __atomic_store_n(&terminating, true, __ATOMIC_SEQ_CST);
+    while(__atomic_load_n(&det_in_pass, __ATOMIC_SEQ_CST))
+        sched_yield();
+    lt_lock_all(&locks); /* Acquiring the locks of the whole state */
+
+    mt_dump(&run_metrics);  /* Final dump of the metrics */
+    if (tr_enabled(&trace)){
+        if (trace.dropped > 0)
+            printf("LOG: %llu trace records were dropped\n", (unsigned long long)trace.dropped);
+        tr_close(&trace);
+    }
+
+    long sets_done = 0;
+    double sets_time = 0;
+    for(int i = 0; set_done != NULL && i < max_threads; i++){
+        sets_done += set_done[i];
+        sets_time += set_time[i];
+    }
+    /* The same, and the work lost to terminations, by workload profile */
+    int prof_threads[WL_N_PROFILES] = {0};
+    long prof_sets[WL_N_PROFILES] = {0};
+    double prof_time[WL_N_PROFILES] = {0}, prof_lost[WL_N_PROFILES] = {0};
+    for(int i = 0; set_done != NULL && i < max_threads; i++){
+        int p = profile_of(i);
+        prof_threads[p] += 1;
+        prof_sets[p] += set_done[i];
+        prof_time[p] += set_time[i];
+        prof_lost[p] += set_lost[i];
+    }
 
     /* Freeing heap memory before program termination */
     free(worker_thr_ids);
-    free(max_available_rcs);
     free(available_rcs);
     free(thr_seeds);
-    for(int i = 0; i < max_threads; i++){
-        free(allocation[i]);
-        free(request[i]);
-        free(cur_request[i]);
+    free(set_start);
+    free(set_count);
+    free(set_done);
+    free(set_time);
+    free(set_lost);
+    wl_destroy();
+    free(safety_work);
+    free(safety_finish);
+    free(safety_left);
+    for(int i = 0; para != NULL && i < max_threads; i++){
         free(para[i]);
     }
-    free(allocation);
-    free(request);
-    free(cur_request);
+    ss_destroy(&store);
+    as_destroy(&astats);
+    ss_destroy(&det_snap);
+    ar_destroy(&det_arena);
+    long pt_reduced = parts.reduced, pt_skipped = parts.skipped;
+    pt_destroy(&parts);
+    free(det_available);
+    seq_destroy(&seqs);
+    if (wfg_mode)
+        wfg_destroy(&wfg);
+    free(rcs_queues);
+    free(waiters);
     free(para);
-    for(int i = 0; i < total_types_rcs; i++){
-        free(resources_name[i]);
+    sc_free(&scen); /* The names and instances of the resource types */
+
+    evlog_flush(&evlog);    /* Writing out the events logged so far */
+    if(evlog_dropped(&evlog) > 0)
+        printf("LOG: %llu events were dropped from the log\n", (unsigned long long)evlog_dropped(&evlog));
+
+    printf("LOG: Deadlock checks = %ld (triggered = %ld, without deadlock = %ld)\n", trigger.checks,
+           trigger.triggered_checks, trigger.clean_checks);
+    if(wfg_mode)
+        printf("LOG: Cycles found by the wait-for graph = %ld\n", wfg.cycles);
+    if(sets_done > 0)
+        printf("LOG: Request sets completed = %ld (%lf per sec), average time to complete = %lf sec\n", sets_done,
+               sets_done / (double)exec_time, sets_time / sets_done);
+    if(sets_time + lost_time > 0)
+        printf("LOG: Goodput = %lf (time on completed request sets = %lf sec, lost to terminations = %lf sec)\n",
+               sets_time / (sets_time + lost_time), sets_time, lost_time);
+    for(int p = 0; p < WL_N_PROFILES; p++){
+        if(prof_threads[p] == 0)
+            continue;
+        printf("LOG: Profile %s: threads = %d, request sets completed = %ld (%lf per sec), time to complete p50 = %lf, "
+               "p99 = %lf, max = %lf sec, work lost = %lf sec\n", wl_profiles[p].name, prof_threads[p], prof_sets[p],
+               prof_sets[p] / (double)exec_time, mt_quantile(&set_latency[p], 0.5) * 1e-9,
+               mt_quantile(&set_latency[p], 0.99) * 1e-9, set_latency[p].max * 1e-9, prof_lost[p]);
     }
-    free(resources_name);
+    if(pt_reduced + pt_skipped > 0)
+        printf("LOG: Incremental detection: threads reduced = %ld, threads of unchanged components skipped = %ld\n",
+               pt_reduced, pt_skipped);
+    if(task_mode)
+        printf("LOG: Task pool of %d threads, tasks stolen = %ld\n", tasks.n_workers, tp_steals(&tasks));
+    if(avoidance)
+        printf("LOG: Grants checked for safety = %ld (without reduction = %ld), delayed as unsafe = %ld\n",
+               safety_checks, safety_fast, unsafe_grants);
+    if(total_victims > 0)
+        printf("LOG: Threads terminated = %d, instances held = %ld, work lost = %lf sec\n", total_victims,
+               lost_instances, lost_time);
+    if(trigger.latency_samples > 0)
+        printf("LOG: Average time to detection = %lf sec\n", trigger.total_latency / trigger.latency_samples);
 
     /* Calculating the average time between successive deadlocks */
 
@@ -107,156 +308,359 @@ void sig_handler(int signum){
     printf("LOG: Average time between deadlocks = %lf sec\n", avg_dlock_time);
     log_msg("LOG: Program Terminated.", true);   /* Terminating the program by passing 'true' to the log_msg() function */
 
-    pthread_mutex_unlock(&mutex);   /* Releasing the mutex lock */
+    lt_unlock_all(&locks);   /* Releasing the locks */
 }
 
 /**
- * Function to simulate a worker thread.
- * @param idx Contains the thread index of the corresponding thread
+ * Function to get the timestamp of a trace record, in ns since the start of the trace.
  */
-void* thread_simulator(void *idx) {
-    int my_idx = *((int*) idx);
-    while(true){
-        bool thr_rcs_acq[total_types_rcs];  /* Boolean array which represents whether all instances of a resource type are
-        completely acquired by the thread or not */
+uint64_t trace_ts(){
+    return (uint64_t)((sim_now() - trace_start) * 1e9);
+}
 
-        for(int i = 0; i < total_types_rcs; i++){
-            thr_rcs_acq[i] = false;
+/**
+ * Functions to mark the start and the end of a write to a column or a row of the state, for the optimistic snapshots.
+ */
+void seq_begin_rcs(int ri){
+    if (seqs.rcs_seq != NULL) seq_write_begin(&seqs.rcs_seq[ri]);
+}
+
+void seq_end_rcs(int ri){
+    if (seqs.rcs_seq != NULL) seq_write_end(&seqs.rcs_seq[ri]);
+}
+
+void seq_begin_row(int t){
+    if (seqs.row_seq != NULL) seq_write_begin(&seqs.row_seq[t]);
+}
+
+void seq_end_row(int t){
+    if (seqs.row_seq != NULL) seq_write_end(&seqs.row_seq[t]);
+}
+
+/**
+ * Function to allocate the current request of a thread for a resource type, which must fit in the available instances.
+ * Must be called with the lock of the resource type held.
+ * @param my_idx Index of the requesting thread
+ * @param ri Index of the resource type
+ * @return Return the remaining request of the thread for the ri-th resource type after the allocation.
+ */
+int grant_rcs(int my_idx, int ri){
+    if (wfg_mode && cur_request[my_idx][ri] != 0)
+        wfg_grant(&wfg, my_idx, ri);
+    if(cur_request[my_idx][ri] != 0){
+        EVLOG(&evlog, EVLOG_ALL, my_idx, EV_ALLOCATE, my_idx, ri, cur_request[my_idx][ri]);
+        mt_count(&run_metrics, my_idx, MT_GRANTS, 1);
+        if (tr_enabled(&trace))
+            tr_emit(&trace, trace_ts(), TR_GRANT, my_idx, ri, cur_request[my_idx][ri]);
+    }
+    seq_begin_rcs(ri);
+    int old = allocation[my_idx][ri];
+    available_rcs[ri] -= cur_request[my_idx][ri];
+    allocation[my_idx][ri] += cur_request[my_idx][ri];
+    request[my_idx][ri] -= cur_request[my_idx][ri];
+    if (as_enabled(&astats))
+        as_update(&astats, my_idx, allocation[my_idx], ri, old);
+    seq_end_rcs(ri);
+    cur_request[my_idx][ri] = 0;
+    return request[my_idx][ri];
+}
+
+bool grant_is_safe(int my_idx, int ri);
+
+/**
+ * Function to make a thread request instances of a resource type, waiting until they can be allocated.
+ * @param my_idx Index of the requesting thread
+ * @param ri Index of the resource type
+ * @param n Number of instances requested, capped to the remaining request of the thread (zero once it is terminated)
+ * @return Return the remaining request of the thread for the ri-th resource type after the allocation.
+ */
+int acquire_rcs(int my_idx, int ri, int n){
+    lt_lock_rcs(&locks, ri); /* Acquiring the lock of the ri-th resource type */
+    uint64_t held = mt_start(&run_metrics);
+    cur_request[my_idx][ri] = min(n, request[my_idx][ri]);
+
+    /* Checking if the curretly requested number of instances of the ri-th resource are more than the available number*/
+    bool requeue = false;
+    while (cur_request[my_idx][ri] >  available_rcs[ri] || (avoidance && !grant_is_safe(my_idx, ri))){
+        /* If true, then we wait in the queue of the ri-th resource until enough instances are released. A thread
+        woken up whose instances were taken in the meantime goes back to the front of the queue. */
+        if (!requeue){
+            trig_block(&trigger, my_idx);   /* May trigger a deadlock check */
+            if (wfg_mode && wfg_block(&wfg, my_idx, ri))
+                trig_fire(&trigger);    /* The new edge closed a cycle */
         }
+        mt_record(&run_metrics, my_idx, MH_LOCK_HOLD, held);    /* The lock is released while waiting */
+        uint64_t blocked = mt_start(&run_metrics);
+        if (cur_request[my_idx][ri] > available_rcs[ri]){
+            /* A thread woken for instances taken in the meantime passes the wake-up on to the waiters that now fit */
+            if (requeue)
+                wq_wake(&rcs_queues[ri], available_rcs[ri]);
+            wq_wait(&rcs_queues[ri], &waiters[my_idx], cur_request[my_idx][ri], requeue, lt_rcs(&locks, ri));
+        }else{
+            /* The instances are available but the grant would be unsafe: they are passed on to the other waiters, and
+            the thread waits for a release */
+            unsafe_grants += 1;
+            wq_wake(&rcs_queues[ri], available_rcs[ri]);
+            wq_wait(&unsafe_queue, &waiters[my_idx], 0, false, lt_rcs(&locks, ri));
+        }
+        mt_record(&run_metrics, my_idx, MH_COND_WAIT, blocked);
+        held = mt_start(&run_metrics);
+        requeue = true;
+    }
+    if (requeue){
+        trig_unblock(&trigger, my_idx);
+        if (wfg_mode)
+            wfg_unblock(&wfg, my_idx);
+    }
 
-        pthread_mutex_lock(&mutex); /* Acquiring the mutex lock */
-        int rcs_acquired = 0;
+    /* If false, then the current request is allocated to the thread */
+    int remaining = grant_rcs(my_idx, ri);
+    mt_record(&run_metrics, my_idx, MH_LOCK_HOLD, held);
+    lt_unlock_rcs(&locks, ri); /* Releasing the lock */
+    return remaining;
+}
 
-        /* Generating the request set R_t for the thread */
-        for(int i = 0; i < total_types_rcs; i++){
-            request[my_idx][i] = (rand_r(&thr_seeds[my_idx]) % (max_available_rcs[i] + 1));
-            if(request[my_idx][i] == 0){
-                rcs_acquired += 1;
-                thr_rcs_acq[i] = true;
-            }
+/**
+ * Function to release all the resources held by a thread.
+ * @param my_idx Index of the releasing thread
+ */
+void release_all_rcs(int my_idx){
+    for(int i = 0; i < total_types_rcs; i++){
+        lt_lock_rcs(&locks, i);  /* Acquiring the lock of the i-th resource type */
+        uint64_t held = mt_start(&run_metrics);
+        seq_begin_rcs(i);
+        available_rcs[i] += allocation[my_idx][i];
+        if(allocation[my_idx][i] != 0){
+            EVLOG(&evlog, EVLOG_ALL, my_idx, EV_RELEASE, my_idx, i, allocation[my_idx][i]);
+            mt_count(&run_metrics, my_idx, MT_RELEASES, 1);
+            if (tr_enabled(&trace))
+                tr_emit(&trace, trace_ts(), TR_RELEASE, my_idx, i, allocation[my_idx][i]);
+            if (wfg_mode)
+                wfg_release(&wfg, my_idx, i);
+            wq_wake(&rcs_queues[i], available_rcs[i]);  /* Waking only the waiters that the released instances can satisfy */
         }
-        pthread_mutex_unlock(&mutex);   /* Releasing the mutex lock */
+        int old = allocation[my_idx][i];
+        allocation[my_idx][i] = 0;
+        if (as_enabled(&astats))
+            as_update(&astats, my_idx, allocation[my_idx], i, old);
+        seq_end_rcs(i);
+        mt_record(&run_metrics, my_idx, MH_LOCK_HOLD, held);
+        lt_unlock_rcs(&locks, i);    /* Releasing the lock */
+    }
+    if (set_done != NULL){
+        double sec = sim_now() - set_start[my_idx];
+        set_done[my_idx] += 1;
+        set_time[my_idx] += sec;
+        record_set_latency(my_idx, sec);
+    }
+    if (avoidance){
+        /* The release may have made the delayed grants safe */
+        lt_lock_all(&locks);
+        wq_wake(&unsafe_queue, 1);
+        lt_unlock_all(&locks);
+    }
+}
 
-        /* The loop continues till the required instances of all the resource types are not acquired */
-        while(rcs_acquired < total_types_rcs){
+/**
+ * Function to derive the seed of the k-th request set of a thread from the seed of the run.
+ */
+unsigned int stream_seed(int run_seed, int thr, int k){
+    unsigned long long x = ((unsigned long long)(unsigned int)run_seed << 32) ^ ((unsigned long long)thr << 20) ^ k;
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return (unsigned int)(x ^ (x >> 31));
+}
 
-            /* Selecting a random resource type whose required number of instances are yet to be allocated to the thread */
-            int ri = (rand_r(&thr_seeds[my_idx]) % (total_types_rcs));
-            while (thr_rcs_acq[ri]){
-                ri = (rand_r(&thr_seeds[my_idx]) % (total_types_rcs));
-            }
+/**
+ * Function to generate the request set R_t of a thread.
+ * @param my_idx Index of the thread
+ * @param thr_rcs_acq Array set to whether the request for every resource type is already complete
+ * @return Return the number of resource types with an empty request.
+ */
+int new_request_set(int my_idx, bool thr_rcs_acq[]){
+    if (set_count != NULL){
+        if (des_mode){
+            /* Every request set draws from its own stream, so that the workload does not depend on the resolutions */
+            thr_seeds[my_idx] = stream_seed(seed, my_idx, set_count[my_idx]);
+        }
+        set_count[my_idx] += 1;
+        set_start[my_idx] = sim_now();
+    }
+    for(int i = 0; i < total_types_rcs; i++){
+        thr_rcs_acq[i] = false;
+    }
 
-            pthread_mutex_lock(&mutex); /* Acquiring the mutex lock */
-            /* Generating a random number of instances of the required number of instances of ri-th resource  */
-            cur_request[my_idx][ri] = (rand_r(&thr_seeds[my_idx]) % (request[my_idx][ri] + 1));
+    lt_lock_row(&locks, my_idx); /* Acquiring the lock of the thread's row */
+    uint64_t held = mt_start(&run_metrics);
+    int rcs_acquired = 0;
 
-            /* Checking if the curretly requested number of instances of the ri-th resource are more than the available number*/
-            while (cur_request[my_idx][ri] >  available_rcs[ri]){
-                /* If true, then we wait on the conditional variable cond */
-                pthread_cond_wait(&cond, &mutex);
+    /* Generating the request set R_t for the thread, as its profile does */
+    seq_begin_row(my_idx);
+    wl_profiles[profile_of(my_idx)].request_set(request[my_idx], total_types_rcs, max_available_rcs, &thr_seeds[my_idx]);
+    for(int i = 0; i < total_types_rcs; i++){
+        if(request[my_idx][i] == 0){
+            rcs_acquired += 1;
+            thr_rcs_acq[i] = true;
+        }
+    }
+    seq_end_row(my_idx);
+    if (tr_enabled(&trace)){
+        /* The request set, as one record followed by its claims */
+        tr_record *r = tr_reserve(&trace, 1 + total_types_rcs - rcs_acquired);
+        if (r != NULL){
+            uint64_t ts = trace_ts();
+            tr_fill(r++, ts, TR_SET, my_idx, -1, total_types_rcs - rcs_acquired);
+            for(int i = 0; i < total_types_rcs; i++){
+                if(request[my_idx][i] != 0)
+                    tr_fill(r++, ts, TR_CLAIM, my_idx, i, request[my_idx][i]);
             }
-            
-            /* If false, then the current request is allocated to the thread */
-            if(cur_request[my_idx][ri] != 0)
-                printf("Allocate %d number of instances of resource type %d to thread %d\n", cur_request[my_idx][ri], ri, my_idx);
-            available_rcs[ri] -= cur_request[my_idx][ri];
-            allocation[my_idx][ri] += cur_request[my_idx][ri];
-            request[my_idx][ri] -= cur_request[my_idx][ri];
-            cur_request[my_idx][ri] = 0;
-            if(request[my_idx][ri] == 0){
+        }
+    }
+    mt_record(&run_metrics, my_idx, MH_LOCK_HOLD, held);
+    lt_unlock_row(&locks, my_idx);   /* Releasing the lock */
+    return rcs_acquired;
+}
+
+/**
+ * Function to pick the next request of a thread: a resource type whose request is not complete, chosen by the profile of
+ * the thread, and a random number of instances of what remains of it.
+ * @param ri Set to the index of the resource type
+ * @return Return the number of instances requested.
+ */
+int next_request(int my_idx, const bool thr_rcs_acq[], int *ri){
+    /* Selecting a resource type whose required number of instances are yet to be allocated to the thread */
+    int r = wl_profiles[profile_of(my_idx)].next_rcs(thr_rcs_acq, total_types_rcs, &thr_seeds[my_idx]);
+    *ri = r;
+
+    /* Requesting a random number of instances of the required number of instances of ri-th resource  */
+    lt_lock_rcs(&locks, r);
+    int n = (rand_r(&thr_seeds[my_idx]) % (request[my_idx][r] + 1));
+    lt_unlock_rcs(&locks, r);
+    return n;
+}
+
+/* Generating a random pause between two successive resource requests by the thread, in [0, 1) seconds for most profiles */
+double request_pause(int my_idx){
+    return wl_profiles[profile_of(my_idx)].pause(&thr_seeds[my_idx]);
+}
+
+/* Holding onto the resources for a random duration, between [0.7d, 1.5d] for most profiles */
+double hold_time(int my_idx){
+    int k = (set_count != NULL) ? set_count[my_idx] - 1 : 0;
+    return wl_profiles[profile_of(my_idx)].hold(d_check_interval, k, &thr_seeds[my_idx]);
+}
+
+void sleep_sec(double sec){
+    struct timespec t;
+    t.tv_sec = (int)(sec);
+    t.tv_nsec = (sec - t.tv_sec) * 1000000000;
+    nanosleep(&t, NULL);
+}
+
+/**
+ * Function to simulate a worker thread.
+ * @param idx Contains the thread index of the corresponding thread
+ */
+void* thread_simulator(void *idx) {
+    int my_idx = *((int*) idx);
+    while(true){
+        bool thr_rcs_acq[total_types_rcs];  /* Boolean array which represents whether all instances of a resource type are
+        completely acquired by the thread or not */
+        int rcs_acquired = new_request_set(my_idx, thr_rcs_acq);
+
+        /* The loop continues till the required instances of all the resource types are not acquired */
+        while(rcs_acquired < total_types_rcs){
+            int ri;
+            int n = next_request(my_idx, thr_rcs_acq, &ri);
+            if(acquire_rcs(my_idx, ri, n) == 0){
                 /* If the required number of instances of a resource type are completely acquired, we perform the following */
                 rcs_acquired += 1;
                 thr_rcs_acq[ri] = true;
             }
-            pthread_mutex_unlock(&mutex); /* Releasing the mutex lock */
-
-            /* Generating a random pause between two successive resource requests by the thread */
-            double rwait = random_double(&thr_seeds[my_idx]);
-            int rwait_nsec = rwait * 1000000000;
-            struct timespec wait_time;
-            wait_time.tv_sec = 0;
-            wait_time.tv_nsec = rwait_nsec;
-            nanosleep(&wait_time, NULL); 
+            sleep_sec(request_pause(my_idx));
         }
         
-        /* Holding onto the resources for a random duration between [0.7d, 1.5d] */
-        double rhalt = random_double_interval(0.7 * d_check_interval, 1.5 * d_check_interval, &thr_seeds[my_idx]);
-        int rhalt_sec = (int)(rhalt);
-        int rhalt_nsec = (rhalt - rhalt_sec) * 1000000000;
-        struct timespec halt_time;
-        halt_time.tv_sec = rhalt_sec;
-        halt_time.tv_nsec = rhalt_nsec;
-        nanosleep(&halt_time, NULL); 
-        pthread_mutex_lock(&mutex); /* Acquiring the mutex lock */
+        sleep_sec(hold_time(my_idx));
 
         /* Releasing all the acquired resources before thread termination */
-        for(int i = 0; i < total_types_rcs; i++){
-            available_rcs[i] += allocation[my_idx][i];
-            if(allocation[my_idx][i] != 0)
-                printf("Release %d number of instances of resource type %d from thread %d\n", allocation[my_idx][i], i, my_idx);
-            allocation[my_idx][i] = 0;
-        }
-        printf("Restarting thread %d\n", my_idx);
-        pthread_cond_broadcast(&cond);  /* Broadcasting a signal to all the threads waiting on the cond variable */
-        pthread_mutex_unlock(&mutex);   /* Releasing the mutex lock */ 
+        release_all_rcs(my_idx);
+        EVLOG(&evlog, EVLOG_ALL, my_idx, EV_RESTART, my_idx, -1, 0);
     }
     pthread_exit(NULL);
     return NULL;
 }
 
 /**
- * Function to find whether the system contains a deadlock
- * @param thr_in_dlock Array to store the indexes of the threads involved in the deadlock
- * @return Return true if deadlock is detected, otherwise false.
+ * Function to allocate a temporary of the detector, freed at the end of the pass.
  */
-bool check_dlock(int thr_in_dlock[]){
-    int work[total_types_rcs];
-    bool finish[max_threads];
+void* det_alloc(size_t bytes){
+    void *p = ar_alloc(&det_arena, bytes);
+    if (p == NULL){
+        log_msg("Failed to allocate memory for deadlock detection.", true);
+    }
+    return p;
+}
+
+/**
+ * Function to set up the reduction of a state: work holds the available instances, and the threads holding nothing are
+ * finished.
+ */
+void reduction_init(dlock_state *st, int work[], bool finish[]){
     for(int i = 0; i < total_types_rcs; i++){
-        work[i] = available_rcs[i];
+        work[i] = st->available[i];
     }
-    bool chk;
-    int count = 0;
     for(int i = 0; i < max_threads; i++){
-        chk = true;
-        for(int j = 0; j < total_types_rcs; j++){
-            if(allocation[i][j] != 0){
-                chk = false;
-                break;
-            }
-        }
-        if(chk) count += 1;
-        finish[i] = chk;
-    }
-
-    bool flag1, flag2;
-    while (count < max_threads){
-        flag1 = false;
-        for (int i = 0; i < max_threads; i++){
-            if (finish[i] == false){
-                flag2 = true;
-                for (int j = 0; j < total_types_rcs; j++){        
-                    if (request[i][j] > work[j]){
-                        flag2 = false;
-                        break;
-                    }
-                }
-                if (flag2){
-                    finish[i] = true; 
-                    count += 1;
-                    flag1 = true;                         
-                    for (int j = 0; j < total_types_rcs; j++){
-                        work[j] = work[j] + allocation[i][j];
-                    }
-                }
-            }
+        finish[i] = (row_max(st->allocation[i], total_types_rcs) <= 0);   /* Threads holding nothing are finished */
+    }
+}
+
+/**
+ * Function to reduce a state from a partial reduction and find the threads left in deadlock.
+ * With the wait-for graph, which follows the state as it changes, st and work are not read, and finish is set from the
+ * cycle found.
+ * @param st State to examine
+ * @param work Instances available to the unfinished threads, updated by the reduction
+ * @param finish Threads already finished, updated by the reduction
+ * @param resume The state only changed since the last reduction by the termination of threads now marked finished,
+ * whose allocation was added to work; the reduction then continues from where it stopped
+ * @param thr_in_dlock Array to store the indexes of the threads involved in the deadlock
+ * @return Return true if deadlock is detected, otherwise false.
+ */
+bool reduce_dlock(dlock_state *st, int work[], bool finish[], bool resume, int thr_in_dlock[]){
+    if (wfg_mode){
+        /* With single-instance resources, the deadlocks are the cycles found by the wait-for graph. As after a
+        reduction, finish then tells the threads left in deadlock: the members of the cycle */
+        int k = wfg_take_cycle(&wfg, thr_in_dlock);
+        for(int i = 0; i < max_threads; i++){
+            finish[i] = true;
         }
-        if (!flag1){
-            break;
+        for(int i = 0; i < k; i++){
+            finish[thr_in_dlock[i]] = false;
         }
+        return k > 0;
+    }
+
+    /* Reducing the state with the worklist engine, which only revisits threads whose blocking resource has grown */
+    const int *request_t = NULL;
+    if (!resume && store.rcs_major && st->request == store.request){
+        /* Refreshing the resource-major copy of request, so that the per-resource lists are gathered column by column */
+        ss_sync_columns(&store);
+        request_t = store.request_t;
+    }
+    int unfinished;
+    if (par_enabled(&dpool, max_threads)){
+        /* Splitting the rows across the helper threads for very large states */
+        unfinished = par_reduce(&dpool, max_threads, total_types_rcs, st->allocation, st->request, work, finish);
+    }else{
+        unfinished = worklist_reduce(max_threads, total_types_rcs, st->allocation, st->request, request_t, store.ld_t,
+                                     work, finish, &det_arena);
+    }
+    if (unfinished < 0){
+        log_msg("Failed to allocate memory for deadlock detection.", true);
     }
     int k = 0;
-    if (count < max_threads){
+    if (unfinished > 0){
         /* Storing the indexes of the threads involved in deadlock, in thr_in_dlock[] */
         for(int i = 0; i < max_threads; i++){
             if(!finish[i])
@@ -268,33 +672,86 @@ bool check_dlock(int thr_in_dlock[]){
     }
 }
 
+/**
+ * Function to find whether a state contains a deadlock
+ * @param st State to examine
+ * @param thr_in_dlock Array to store the indexes of the threads involved in the deadlock
+ * @return Return true if deadlock is detected, otherwise false.
+ */
+bool check_dlock_state(dlock_state *st, int thr_in_dlock[]){
+    ar_mark mark = ar_save(&det_arena);
+    int *work = (int *)det_alloc(sizeof(int) * total_types_rcs);
+    bool *finish = (bool *)det_alloc(sizeof(bool) * max_threads);
+    reduction_init(st, work, finish);
+    bool is_dlock = reduce_dlock(st, work, finish, false, thr_in_dlock);
+    ar_restore(&det_arena, mark);
+    return is_dlock;
+}
+
+/**
+ * Function to find whether the system contains a deadlock
+ * @param thr_in_dlock Array to store the indexes of the threads involved in the deadlock
+ * @return Return true if deadlock is detected, otherwise false.
+ */
+bool check_dlock(int thr_in_dlock[]){
+    dlock_state st = {allocation, request, available_rcs};
+    return check_dlock_state(&st, thr_in_dlock);
+}
+
+/**
+ * Function to get the aggregates of an allocation matrix for the heuristics. The maintained aggregates are used for the
+ * live matrix; a snapshot, or a matrix set up without them, has its rows scanned.
+ */
+const alloc_stats *stats_of(int **alloc){
+    return (alloc == allocation && as_enabled(&astats)) ? &astats : NULL;
+}
+
+/**
+ * Function to check, for the Banker's algorithm, whether granting the current request of a thread leaves a safe state,
+ * where every thread claims at most its remaining request. The state before the grant is safe, so the grant is safe
+ * when the thread could then complete its request set with the instances available, whatever the others do. Otherwise
+ * the grant is applied to the state, which is reduced and restored.
+ * Must be called with the locks of the whole state held.
+ * @param my_idx Index of the requesting thread
+ * @param ri Index of the resource type
+ * @return Return true if the grant is safe.
+ */
+bool grant_is_safe(int my_idx, int ri){
+    int n = cur_request[my_idx][ri];
+    if (n == 0)
+        return true;
+    safety_checks += 1;
+    if (row_le(request[my_idx], available_rcs, total_types_rcs)){
+        safety_fast += 1;
+        return true;
+    }
+    available_rcs[ri] -= n;
+    allocation[my_idx][ri] += n;
+    request[my_idx][ri] -= n;
+    for(int i = 0; i < max_threads; i++){
+        safety_left[i] = -1;
+    }
+    dlock_state st = {allocation, request, available_rcs};
+    reduction_init(&st, safety_work, safety_finish);
+    bool safe = !reduce_dlock(&st, safety_work, safety_finish, false, safety_left);
+    available_rcs[ri] += n;
+    allocation[my_idx][ri] -= n;
+    request[my_idx][ri] += n;
+    return safe;
+}
+
 /**
  * Function to find the index of the thread involved in a deadlock, such that it has maximum total instances of all resource 
  * types allocated to it.
  * @param thr_in_dlock Array containing the indexes of the threads involved in the deadlock
  * @return Return the index of the thread in thr_in_dlock[] with maximum total instances of all resources allocated to it.
  */
+int max_total_rcs_thrIdx_of(int **alloc, int thr_in_dlock[]){
+    return vs_select(VS_MAX_TOTAL, alloc, total_types_rcs, stats_of(alloc), thr_in_dlock, max_threads);
+}
+
 int max_total_rcs_thrIdx(int thr_in_dlock[]){
-    int total_rcs_per_thr[max_threads];
-    for(int i = 0; i < max_threads; i++){
-        total_rcs_per_thr[i] = 0;
-    }
-    for(int i = 0; i < max_threads; i++){
-        for(int j = 0; j < total_types_rcs; j++){
-            total_rcs_per_thr[i] += allocation[i][j];
-        }
-    }
-    int max_total_rcs = 0, max_thrIdx;
-    for(int i = 0; i < max_threads; i++){
-        if(thr_in_dlock[i] == -1){
-            break;
-        }
-        if(total_rcs_per_thr[thr_in_dlock[i]] > max_total_rcs){
-            max_total_rcs = total_rcs_per_thr[thr_in_dlock[i]];
-            max_thrIdx = thr_in_dlock[i];
-        }
-    }
-    return max_thrIdx;
+    return max_total_rcs_thrIdx_of(allocation, thr_in_dlock);
 }
 
 /**
@@ -303,28 +760,12 @@ int max_total_rcs_thrIdx(int thr_in_dlock[]){
  * @param thr_in_dlock Array containing the indexes of the threads involved in the deadlock
  * @return Return the index of the thread in thr_in_dlock[] with maximum instances of any resource type allocated to it.
  */
-int max_any_rcs_thrIdx(int thr_in_dlock[]){
-    int max_rcs_per_thr[max_threads];
-    for(int i = 0; i < max_threads; i++){
-        max_rcs_per_thr[i] = 0;
-    }
-    for(int i = 0; i < max_threads; i++){
-        for(int j = 0; j < total_types_rcs; j++){
-            max_rcs_per_thr[i] = max(max_rcs_per_thr[i], allocation[i][j]);
-        }
-    }
-    int max_any_rcs = 0, max_thrIdx;
-    for(int i = 0; i < max_threads; i++){
-        if(thr_in_dlock[i] == -1){
-            break;
-        }
-        if(max_rcs_per_thr[thr_in_dlock[i]] > max_any_rcs){
-            max_any_rcs = max_rcs_per_thr[thr_in_dlock[i]];
-            max_thrIdx = thr_in_dlock[i];
-        }
-    }
-    return max_thrIdx;
+int max_any_rcs_thrIdx_of(int **alloc, int thr_in_dlock[]){
+    return vs_select(VS_MAX_ANY, alloc, total_types_rcs, stats_of(alloc), thr_in_dlock, max_threads);
+}
 
+int max_any_rcs_thrIdx(int thr_in_dlock[]){
+    return max_any_rcs_thrIdx_of(allocation, thr_in_dlock);
 }
 
 /**
@@ -333,27 +774,12 @@ int max_any_rcs_thrIdx(int thr_in_dlock[]){
  * @param thr_in_dlock Array containing the indexes of the threads involved in the deadlock
  * @return Return the index of the thread in thr_in_dlock[] with minimum total instances of all resources allocated to it.
  */
+int min_total_rcs_thrIdx_of(int **alloc, int thr_in_dlock[]){
+    return vs_select(VS_MIN_TOTAL, alloc, total_types_rcs, stats_of(alloc), thr_in_dlock, max_threads);
+}
+
 int min_total_rcs_thrIdx(int thr_in_dlock[]){
-    int total_rcs_per_thr[max_threads];
-    for(int i = 0; i < max_threads; i++){
-        total_rcs_per_thr[i] = 0;
-    }
-    for(int i = 0; i < max_threads; i++){
-        for(int j = 0; j < total_types_rcs; j++){
-            total_rcs_per_thr[i] += allocation[i][j];
-        }
-    }
-    int min_total_rcs = INT_MAX, min_thrIdx;
-    for(int i = 0; i < max_threads; i++){
-        if(thr_in_dlock[i] == -1){
-            break;
-        }
-        if(total_rcs_per_thr[thr_in_dlock[i]] < min_total_rcs){
-            min_total_rcs = total_rcs_per_thr[thr_in_dlock[i]];
-            min_thrIdx = thr_in_dlock[i];
-        }
-    }
-    return min_thrIdx;
+    return min_total_rcs_thrIdx_of(allocation, thr_in_dlock);
 }
 
 /**
@@ -363,27 +789,12 @@ int min_total_rcs_thrIdx(int thr_in_dlock[]){
  * @return Return the index of the thread in thr_in_dlock[] with minimum instances of any resource type allocated to it.
  */
 
+int min_any_rcs_thrIdx_of(int **alloc, int thr_in_dlock[]){
+    return vs_select(VS_MIN_ANY, alloc, total_types_rcs, stats_of(alloc), thr_in_dlock, max_threads);
+}
+
 int min_any_rcs_thrIdx(int thr_in_dlock[]){
-    int min_rcs_per_thr[max_threads];
-    for(int i = 0; i < max_threads; i++){
-        min_rcs_per_thr[i] = INT_MAX;
-    }
-    for(int i = 0; i < max_threads; i++){
-        for(int j = 0; j < total_types_rcs; j++){
-            min_rcs_per_thr[i] = min(min_rcs_per_thr[i], allocation[i][j]);
-        }
-    }
-    int min_any_rcs = INT_MAX, min_thrIdx;
-    for(int i = 0; i < max_threads; i++){
-        if(thr_in_dlock[i] == -1){
-            break;
-        }
-        if(min_rcs_per_thr[thr_in_dlock[i]] < min_any_rcs){
-            min_any_rcs = min_rcs_per_thr[thr_in_dlock[i]];
-            min_thrIdx = thr_in_dlock[i];
-        }
-    }
-    return min_thrIdx;
+    return min_any_rcs_thrIdx_of(allocation, thr_in_dlock);
 }
 
 int linear_thrIdx(int thr_in_dlock[]){
@@ -391,40 +802,347 @@ int linear_thrIdx(int thr_in_dlock[]){
 }
 /**
  * Function to return the index of the thread in thr_in_dlock[] to be terminated, based on the heuristic being followed. 
+ * @param alloc Allocation matrix the heuristic is evaluated on
  * @param thr_in_dlock Array containing the indexes of the threads involved in the deadlock
  * @return Return the index of the thread in thr_in_dlock[], which should be terminated in an attempt to resolve the deadlock.
  */
+int select_thr_to_cncl_of(int **alloc, int thr_in_dlock[]){
+    return vs_select(heuristic_no, alloc, total_types_rcs, stats_of(alloc), thr_in_dlock, max_threads);
+}
+
 int select_thr_to_cncl(int thr_in_dlock[]){
-    int thrIdx;
-    switch (heuristic_no){
-        case 1: thrIdx = max_total_rcs_thrIdx(thr_in_dlock);
-                break;
-        case 2: thrIdx = max_any_rcs_thrIdx(thr_in_dlock);
-                break;
-        case 3: thrIdx = min_total_rcs_thrIdx(thr_in_dlock);
-                break;
-        case 4: thrIdx = min_any_rcs_thrIdx(thr_in_dlock);
-                break;
-        case 5: thrIdx = linear_thrIdx(thr_in_dlock);
-                break;
+    return select_thr_to_cncl_of(allocation, thr_in_dlock);
+}
+
+/**
+ * Function to find whether terminating a set of threads would resolve every deadlock of a state.
+ * @param work Instances available to the unfinished threads, from a reduction of the state
+ * @param finish Threads finished by that reduction
+ * @param skip Index in victims[] of a victim left out, -1 for none
+ * @param trial_work Scratch array of total_types_rcs ints
+ * @param trial_finish Scratch array of max_threads bools
+ * @param scratch Scratch array of max_threads ints
+ * @return Return true if no thread would be left in deadlock.
+ */
+bool victims_resolve(dlock_state *st, const int work[], const bool finish[], const int victims[], int n_victims, int skip,
+                     int trial_work[], bool trial_finish[], int scratch[]){
+    memcpy(trial_work, work, sizeof(int) * total_types_rcs);
+    memcpy(trial_finish, finish, sizeof(bool) * max_threads);
+    for(int i = 0; i < n_victims; i++){
+        if(i == skip)
+            continue;
+        row_add(trial_work, st->allocation[victims[i]], total_types_rcs);
+        trial_finish[victims[i]] = true;
     }
-   return thrIdx;
+    return !reduce_dlock(st, trial_work, trial_finish, true, scratch);
+}
+
+/**
+ * Function to choose, in one step, a set of deadlocked threads whose termination resolves every deadlock of a state.
+ * The threads the heuristic would pick one after the other are taken first, as if each one had been terminated and
+ * the state checked again. Every victim whose termination turns out not to be needed once the later ones are terminated
+ * is then spared, the later victims first.
+ * @param work Instances available to the unfinished threads, from a reduction of the state
+ * @param finish Threads finished by that reduction
+ * @param thr_in_dlock Array containing the indexes of the threads involved in the deadlock
+ * @param victims Array receiving the threads to terminate
+ * @return Return the number of threads stored in victims[].
+ */
+int select_victims(dlock_state *st, const int work[], const bool finish[], const int thr_in_dlock[], int victims[]){
+    ar_mark mark = ar_save(&det_arena);
+    int *trial_work = (int *)det_alloc(sizeof(int) * total_types_rcs);
+    bool *trial_finish = (bool *)det_alloc(sizeof(bool) * max_threads);
+    int *left = (int *)det_alloc(sizeof(int) * max_threads);
+    memcpy(left, thr_in_dlock, sizeof(int) * max_threads);
+    memcpy(trial_work, work, sizeof(int) * total_types_rcs);
+    memcpy(trial_finish, finish, sizeof(bool) * max_threads);
+
+    /* Picking victims with the heuristic until no thread is left in deadlock */
+    int n = 0;
+    bool is_dlock = true;
+    while(is_dlock){
+        int v = select_thr_to_cncl_of(st->allocation, left);
+        victims[n++] = v;
+        row_add(trial_work, st->allocation[v], total_types_rcs);
+        trial_finish[v] = true;
+        for(int i = 0; i < max_threads; i++){
+            left[i] = -1;
+        }
+        is_dlock = reduce_dlock(st, trial_work, trial_finish, true, left);
+    }
+
+    /* Sparing the victims that the others make unnecessary */
+    for(int i = n - 1; i >= 0 && n > 1; i--){
+        for(int t = 0; t < max_threads; t++){
+            left[t] = -1;
+        }
+        if(victims_resolve(st, work, finish, victims, n, i, trial_work, trial_finish, left)){
+            memmove(&victims[i], &victims[i + 1], sizeof(int) * (n - i - 1));
+            n -= 1;
+        }
+    }
+    ar_restore(&det_arena, mark);
+    return n;
 }
 
 /**
  * This function accepts the index of the thread to be terminated, thereby making the correspoding request, allocation and cur_request row
  * to be zero. 
+ * Must be called with the locks of the whole state held.
  * @param thr_to_cncl Index of the thread to be terminated.
  */
 void resolve_dlock(int thrIdx_to_cncl){
-    printf("LOG: Terminating thread %d and retrying...\n", thrIdx_to_cncl);
+    EVLOG(&evlog, EVLOG_DETECTOR, max_threads, EV_TERMINATE, thrIdx_to_cncl, -1, 0);
+    mt_count(&run_metrics, max_threads, MT_VICTIMS, 1);
+    if (tr_enabled(&trace))
+        tr_emit(&trace, trace_ts(), TR_TERMINATE, thrIdx_to_cncl, -1, 0);
+    total_victims += 1;
+    lost_instances += row_sum(allocation[thrIdx_to_cncl], total_types_rcs);
+    if (set_start != NULL){
+        lost_time += sim_now() - set_start[thrIdx_to_cncl];
+        set_lost[thrIdx_to_cncl] += sim_now() - set_start[thrIdx_to_cncl];
+    }
 
+    seq_begin_row(thrIdx_to_cncl);
     for(int i = 0; i < total_types_rcs; i++){
+        if (wfg_mode && allocation[thrIdx_to_cncl][i] != 0)
+            wfg_release(&wfg, thrIdx_to_cncl, i);
+        seq_begin_rcs(i);
         available_rcs[i] += allocation[thrIdx_to_cncl][i];
         allocation[thrIdx_to_cncl][i] = 0;
         request[thrIdx_to_cncl][i] = 0;
+        seq_end_rcs(i);
         cur_request[thrIdx_to_cncl][i] = 0;
     }
+    seq_end_row(thrIdx_to_cncl);
+    if (as_enabled(&astats))
+        as_clear(&astats, thrIdx_to_cncl);
+    if (wfg_mode)
+        wfg_unblock(&wfg, thrIdx_to_cncl);
+    if (rcs_queues != NULL){
+        /* The terminated thread leaves the queue it waits on, and the freed instances are handed to the waiters */
+        wq_cancel(&waiters[thrIdx_to_cncl]);
+        for(int i = 0; i < total_types_rcs; i++){
+            wq_wake(&rcs_queues[i], available_rcs[i]);
+        }
+        if (avoidance)
+            wq_wake(&unsafe_queue, 1);
+    }
+}
+
+/**
+ * Function to start a detection pass.
+ * With SNAP_OPTIMISTIC, the state is copied without taking any lock, falling back to a locked copy if it keeps changing.
+ * With SNAP_LOCKED in LOCK_GLOBAL mode, the world lock is taken and held until detection_end(), and the live state is
+ * examined. With SNAP_LOCKED in LOCK_SHARDED mode, the whole state is locked only for as long as it takes to copy it.
+ * @return Return the state to be examined.
+ */
+dlock_state detection_begin(){
+    if (det_snap.block == NULL && (snapshot_mode == SNAP_OPTIMISTIC || locks.mode == LOCK_SHARDED)){
+        /* The detector never reads cur_request */
+        if (!ss_init_ex(&det_snap, max_threads, total_types_rcs, false, compact_state, false)){
+            log_msg("Failed to allocate the detector snapshot.", true);
+        }
+        det_available = (int *)malloc(sizeof(int) * total_types_rcs);
+    }
+    dlock_state snap = {det_snap.allocation, det_snap.request, det_available};
+    if (snapshot_mode == SNAP_OPTIMISTIC){
+        int recopied = snap_take_optimistic(&seqs, allocation, request, available_rcs, det_snap.allocation,
+                                            det_snap.request, det_available, SNAP_MAX_PASSES);
+        if (recopied >= 0){
+            snap_recopies += recopied;
+            if (pt_enabled(&parts))
+                pt_observe(&parts, seqs.seen);  /* The counters the copy was validated with */
+            det_check_rec = tr_enabled(&trace) ? tr_reserve(&trace, 1) : NULL;  /* Placed after the copy */
+            return snap;
+        }
+        snap_fallbacks += 1;
+    }
+
+    lt_lock_all(&locks);
+    /* The record of the check is placed in the trace where the state is taken */
+    det_check_rec = tr_enabled(&trace) ? tr_reserve(&trace, 1) : NULL;
+    if (pt_enabled(&parts))
+        pt_observe(&parts, seqs.rcs_seq);   /* The columns' counters, followed by the rows' */
+    if (locks.mode == LOCK_GLOBAL && snapshot_mode == SNAP_LOCKED){
+        det_holds_lock = true;
+        det_lock_start = mt_start(&run_metrics);
+        dlock_state live = {allocation, request, available_rcs};
+        return live;
+    }
+    for(int i = 0; i < max_threads; i++){
+        memcpy(det_snap.allocation[i], allocation[i], sizeof(int) * total_types_rcs);
+        memcpy(det_snap.request[i], request[i], sizeof(int) * total_types_rcs);
+    }
+    memcpy(det_available, available_rcs, sizeof(int) * total_types_rcs);
+    lt_unlock_all(&locks);
+    return snap;
+}
+
+/**
+ * Function to end a detection pass started by detection_begin().
+ */
+void detection_end(){
+    if (det_holds_lock){
+        det_holds_lock = false;
+        mt_record(&run_metrics, max_threads, MH_LOCK_HOLD, det_lock_start);
+        lt_unlock_all(&locks);
+    }
+}
+
+/**
+ * Function to terminate a victim chosen on the examined state. When the state is a snapshot, the victim is terminated
+ * under the locks of the whole state only if its rows still match the snapshot, and the termination is applied to the
+ * snapshot as well.
+ * @param st State the victim was chosen on
+ * @param thrIdx_to_cncl Index of the thread to be terminated
+ * @return Return true if the thread was terminated, false if the state changed since the snapshot.
+ */
+bool terminate_victim(dlock_state *st, int thrIdx_to_cncl){
+    if (st->allocation == allocation){
+        resolve_dlock(thrIdx_to_cncl);
+        return true;
+    }
+    lt_lock_all(&locks);
+    bool valid = memcmp(allocation[thrIdx_to_cncl], st->allocation[thrIdx_to_cncl], sizeof(int) * total_types_rcs) == 0 &&
+                 memcmp(request[thrIdx_to_cncl], st->request[thrIdx_to_cncl], sizeof(int) * total_types_rcs) == 0;
+    if (valid){
+        resolve_dlock(thrIdx_to_cncl);
+    }
+    lt_unlock_all(&locks);
+    if (!valid){
+        return false;
+    }
+    for(int i = 0; i < total_types_rcs; i++){
+        st->available[i] += st->allocation[thrIdx_to_cncl][i];
+        st->allocation[thrIdx_to_cncl][i] = 0;
+        st->request[thrIdx_to_cncl][i] = 0;
+    }
+    return true;
+}
+
+/**
+ * Function to detect the deadlocks and resolve them.
+ * @return Return true if a deadlock was found.
+ */
+bool detect_and_resolve(){
+    if (wfg_mode && !wfg_pending(&wfg)){
+        /* The wait-for graph found no cycle since the last check, so the state needs no examination */
+        EVLOG(&evlog, EVLOG_DETECTOR, max_threads, EV_DETECT_START, -1, -1, 0);
+        EVLOG(&evlog, EVLOG_DETECTOR, max_threads, EV_NO_DLOCK, -1, -1, 0);
+        mt_count(&run_metrics, max_threads, MT_CHECKS, 1);
+        if (tr_enabled(&trace))
+            tr_emit(&trace, trace_ts(), TR_CHECK, -1, -1, 0);
+        trig_feedback(&trigger, false);
+        return false;
+    }
+    dlock_state st = detection_begin(); /* Locking the state, or taking a snapshot of it */
+    end_time = sim_now();
+    EVLOG(&evlog, EVLOG_DETECTOR, max_threads, EV_DETECT_START, -1, -1, 0);
+    int *thr_in_dlock = (int *)det_alloc(sizeof(int) * max_threads);
+    int thrIdx_to_cncl;
+    for(int i = 0; i < max_threads; i++){
+        thr_in_dlock[i] = -1;
+    }
+    /* The reduction is kept across the resolution, so that the check after each victim resumes it */
+    int *work = (int *)det_alloc(sizeof(int) * total_types_rcs);
+    bool *finish = (bool *)det_alloc(sizeof(bool) * max_threads);
+    int *victims = (int *)det_alloc(sizeof(int) * max_threads);
+    int *freed = (int *)det_alloc(sizeof(int) * total_types_rcs);
+    uint64_t checking = mt_start(&run_metrics);
+    if (pt_enabled(&parts)){
+        /* Only the components that changed since the last pass are reduced */
+        memcpy(work, st.available, sizeof(int) * total_types_rcs);
+        pt_plan(&parts, st.allocation, st.request, finish);
+    }else{
+        reduction_init(&st, work, finish);
+    }
+    bool is_dlock = reduce_dlock(&st, work, finish, false, thr_in_dlock);  /* Check the presence of deadlock */
+    mt_record(&run_metrics, max_threads, MH_CHECK, checking);
+    mt_count(&run_metrics, max_threads, MT_CHECKS, 1);
+    if (det_check_rec != NULL){
+        int k = 0;
+        while(k < max_threads && thr_in_dlock[k] != -1)
+            k++;
+        tr_fill(det_check_rec, trace_ts(), TR_CHECK, -1, -1, k);
+        det_check_rec = NULL;
+    }
+    bool is_dlock_found = is_dlock;
+    if (is_dlock){
+        uint64_t resolving = mt_start(&run_metrics);
+        int victims_before = total_victims;
+        mt_count(&run_metrics, max_threads, MT_DLOCKS, 1);
+        total_dlocks += 1;
+        total_time_btw_dlocks += end_time - start_time;
+        start_time = sim_now();
+        bool first = true;
+        while(is_dlock){
+            int k = 0;
+            while(k < max_threads && thr_in_dlock[k] != -1)
+                k++;
+            if (first && !des_mode)
+                trig_record_latency(&trigger, thr_in_dlock, k);
+            first = false;
+            EVLOG(&evlog, EVLOG_DETECTOR, max_threads, EV_DLOCK_FOUND, -1, -1, k);
+            for(int i = 0; i < k; i++){
+                EVLOG(&evlog, EVLOG_DETECTOR, max_threads, EV_DLOCK_MEMBER, thr_in_dlock[i], i, k);
+            }
+            int n_victims = 1;
+            if (multi_victim && !wfg_mode){
+                n_victims = select_victims(&st, work, finish, thr_in_dlock, victims);
+            }else{
+                victims[0] = select_thr_to_cncl_of(st.allocation, thr_in_dlock);
+            }
+            bool deferred = false;
+            for(int v = 0; v < n_victims; v++){
+                thrIdx_to_cncl = victims[v];
+                memcpy(freed, st.allocation[thrIdx_to_cncl], sizeof(int) * total_types_rcs);
+                if (!terminate_victim(&st, thrIdx_to_cncl)){  /* Trying to resolve deadlock*/
+                    deferred = true;
+                    break;
+                }
+                /* Continuing the reduction with the instances released by the victim */
+                row_add(work, freed, total_types_rcs);
+                finish[thrIdx_to_cncl] = true;
+            }
+            if (deferred){
+                EVLOG(&evlog, EVLOG_DETECTOR, max_threads, EV_DEFERRED, -1, -1, 0);
+                break;
+            }
+            for(int i = 0; i < max_threads; i++){
+                thr_in_dlock[i] = -1;
+            }
+            is_dlock = reduce_dlock(&st, work, finish, true, thr_in_dlock);
+        }
+        if (!is_dlock)
+            EVLOG(&evlog, EVLOG_DETECTOR, max_threads, EV_RESOLVED, -1, -1, 0);
+        mt_record(&run_metrics, max_threads, MH_RESOLVE, resolving);
+        mt_value(&run_metrics, max_threads, MH_VICTIMS, total_victims - victims_before);
+    }else{
+        EVLOG(&evlog, EVLOG_DETECTOR, max_threads, EV_NO_DLOCK, -1, -1, 0);
+    }
+    if (pt_enabled(&parts))
+        pt_commit(&parts, finish);
+    trig_feedback(&trigger, is_dlock_found);    /* Adapting the detection interval */
+    detection_end();   /* Releasing the lock */
+    ar_reset(&det_arena);
+    return is_dlock_found;
+}
+
+/**
+ * Function to run one deadlock detection pass, unless the program is terminating.
+ * @return Return true if a deadlock was found.
+ */
+bool detection_pass(){
+    __atomic_store_n(&det_in_pass, true, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&terminating, __ATOMIC_SEQ_CST)){
+        /* The program is terminating and its state is being freed */
+        __atomic_store_n(&det_in_pass, false, __ATOMIC_SEQ_CST);
+        return false;
+    }
+    bool found = detect_and_resolve();
+    __atomic_store_n(&det_in_pass, false, __ATOMIC_SEQ_CST);
+    return found;
 }
 
 /**
@@ -433,46 +1151,15 @@ void resolve_dlock(int thrIdx_to_cncl){
  */
 
 void* dlock_detection_thr(void * dummy){
+    /* sig_handler() waits for the detector to leave its pass, so it must not run on the detector */
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGALRM);
+    sigaddset(&set, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
     while(true){
-        sleep(d_check_interval);    /* To sleep the thread for the input deadlock detection interval */
-        pthread_mutex_lock(&mutex); /* Acquiring the mutex lock */
-        gettimeofday(&end_time, NULL);
-        printf("\nLOG: Deadlock detection started...\n");
-        int thr_in_dlock[max_threads];
-        int thrIdx_to_cncl;
-        for(int i = 0; i < max_threads; i++){
-            thr_in_dlock[i] = -1;
-        }
-        bool is_dlock = check_dlock(thr_in_dlock);  /* Check the presence of deadlock */
-        if (is_dlock){
-            total_dlocks += 1;
-            double time_taken;
-            time_taken = (end_time.tv_sec - start_time.tv_sec) * 1e6;
-            time_taken = (time_taken + (end_time.tv_usec - start_time.tv_usec)) * 1e-6;
-            total_time_btw_dlocks += time_taken;
-            gettimeofday(&start_time, NULL);
-            while(is_dlock){
-                printf("LOG: Deadlock Detected. Threads in deadlock are: ");
-                for(int i = 0; i < max_threads; i++){
-                    if(thr_in_dlock[i] == -1)
-                        break;
-                    printf("%d ", thr_in_dlock[i]);
-                }
-                printf("\n");
-                thrIdx_to_cncl = select_thr_to_cncl(thr_in_dlock);
-                resolve_dlock(thrIdx_to_cncl);  /* Trying to resolve deadlock*/
-                for(int i = 0; i < max_threads; i++){
-                    thr_in_dlock[i] = -1;
-                }
-                is_dlock = check_dlock(thr_in_dlock);
-            }
-            printf("LOG: Deadlock Resolved.\n");
-        }else{
-            printf("LOG: No Deadlock.\n");
-        }
-        printf("\n");
-        pthread_cond_broadcast(&cond);  /* Broadcasting signal to threads waiting on the condition variable cond*/
-        pthread_mutex_unlock(&mutex);   /* Releasing the mutex lock */
+        trig_wait(&trigger);    /* To sleep the thread until the next check is due or triggered by blocked threads */
+        detection_pass();
     }
     pthread_exit(NULL);
     return NULL;
@@ -482,7 +1169,7 @@ void* dlock_detection_thr(void * dummy){
  * This function creates the worker threads and the deadlock detection thread.
  */
 void createAllThreads(){
-    gettimeofday(&start_time, NULL);
+    start_time = sim_now();
     int rc;
     worker_thr_ids = (pthread_t *)malloc(sizeof(pthread_t) * max_threads);
     para = (int **)malloc(sizeof(int *) * max_threads);
@@ -503,3 +1190,414 @@ void createAllThreads(){
     }
     pthread_join(detector_thr_id, NULL);
 }
+
+/*
+ * Discrete-event simulation.
+ * The workers are state machines stepped by events of a virtual clock instead of threads: the pauses and the holding
+ * times only schedule the next step, and a blocked worker is stepped again once wq_wake() or wq_cancel() signals its
+ * waiter. The detector runs every d_check_interval of virtual time. Everything runs on the calling thread, so a run only
+ * depends on the seed.
+ */
+enum {
+    DES_START,      /* Generate a new request set */
+    DES_REQUEST,    /* Make the next request, or hold the resources once the set is complete */
+    DES_BLOCKED,    /* Waiting in the queue of des_ri[t] */
+    DES_RELEASE     /* Release everything and restart */
+};
+enum {DES_EV_WORKER, DES_EV_DETECT};
+
+des_queue des_events;
+int *des_phase = NULL;  /* Phase of every worker */
+bool *des_acq = NULL;   /* Row t: whether the request of thread t for every resource type is complete */
+int *des_acquired = NULL;   /* Number of complete resource types of every worker */
+int *des_ri = NULL; /* Resource type of the last request of every worker */
+int *des_blocked = NULL;    /* Blocked workers */
+int n_des_blocked = 0;
+
+void des_schedule(double t, int kind, int who){
+    if (!des_push(&des_events, t, kind, who)){
+        log_msg("Failed to allocate the event queue.", true);
+    }
+}
+
+/**
+ * Function to step again the blocked workers whose waiter was signalled.
+ */
+void des_wake(){
+    for(int k = 0; k < n_des_blocked; ){
+        int t = des_blocked[k];
+        if (waiters[t].signalled){
+            des_blocked[k] = des_blocked[--n_des_blocked];
+            des_schedule(des_clock, DES_EV_WORKER, t);
+        }else{
+            k++;
+        }
+    }
+}
+
+/**
+ * Function to allocate the current request of a worker, or queue it if it does not fit.
+ * @param requeue The worker was woken but its instances were taken in the meantime
+ */
+void des_acquire(int t, bool requeue){
+    int ri = des_ri[t];
+    if (cur_request[t][ri] > available_rcs[ri]){
+        if (!requeue && wfg_mode)
+            wfg_block(&wfg, t, ri);
+        if (requeue && wq_wake(&rcs_queues[ri], available_rcs[ri]) > 0)
+            des_wake(); /* The wake-up is passed on, as in acquire_rcs() */
+        wq_push(&rcs_queues[ri], &waiters[t], cur_request[t][ri], requeue);
+        des_phase[t] = DES_BLOCKED;
+        des_blocked[n_des_blocked++] = t;
+        return;
+    }
+    if (avoidance && !grant_is_safe(t, ri)){
+        /* As in acquire_rcs(), the instances are passed on and the worker waits for a release */
+        unsafe_grants += 1;
+        wq_wake(&rcs_queues[ri], available_rcs[ri]);
+        wq_push(&unsafe_queue, &waiters[t], 0, false);
+        des_phase[t] = DES_BLOCKED;
+        des_blocked[n_des_blocked++] = t;
+        des_wake();
+        return;
+    }
+    if (requeue && wfg_mode)
+        wfg_unblock(&wfg, t);
+    if (grant_rcs(t, ri) == 0){
+        des_acquired[t] += 1;
+        des_acq[t * total_types_rcs + ri] = true;
+    }
+    des_phase[t] = DES_REQUEST;
+    des_schedule(des_clock + request_pause(t), DES_EV_WORKER, t);
+}
+
+/**
+ * Function to step a worker, as thread_simulator() would run between two pauses.
+ */
+void des_step(int t){
+    bool *acq = &des_acq[t * total_types_rcs];
+    switch(des_phase[t]){
+        case DES_START:
+            des_acquired[t] = new_request_set(t, acq);
+            des_phase[t] = DES_REQUEST;
+            /* Falls through */
+        case DES_REQUEST:
+            if (des_acquired[t] >= total_types_rcs){
+                des_phase[t] = DES_RELEASE;
+                des_schedule(des_clock + hold_time(t), DES_EV_WORKER, t);
+                return;
+            }
+            int n = next_request(t, acq, &des_ri[t]);
+            cur_request[t][des_ri[t]] = min(n, request[t][des_ri[t]]);
+            des_acquire(t, false);
+            return;
+        case DES_BLOCKED:
+            des_acquire(t, true);
+            return;
+        case DES_RELEASE:
+            release_all_rcs(t);
+            EVLOG(&evlog, EVLOG_ALL, t, EV_RESTART, t, -1, 0);
+            des_wake();
+            des_phase[t] = DES_START;
+            des_schedule(des_clock, DES_EV_WORKER, t);
+            return;
+    }
+}
+
+/**
+ * Function to run the simulation in virtual time.
+ * @param duration Virtual time to simulate, in seconds
+ */
+void des_run(double duration){
+    des_mode = true;
+    des_clock = 0;
+    n_des_blocked = 0;
+    des_phase = (int *)calloc(max_threads, sizeof(int));
+    des_acq = (bool *)calloc((size_t)max_threads * total_types_rcs, sizeof(bool));
+    des_acquired = (int *)calloc(max_threads, sizeof(int));
+    des_ri = (int *)calloc(max_threads, sizeof(int));
+    des_blocked = (int *)malloc(sizeof(int) * max_threads);
+    if (des_phase == NULL || des_acq == NULL || des_acquired == NULL || des_ri == NULL || des_blocked == NULL ||
+        !des_init(&des_events, 2 * max_threads + 2)){
+        log_msg("Failed to allocate the discrete-event simulation.", true);
+    }
+    start_time = 0;
+    for(int t = 0; t < max_threads; t++){
+        des_schedule(0, DES_EV_WORKER, t);
+    }
+    des_schedule(d_check_interval, DES_EV_DETECT, -1);
+
+    des_event e;
+    double next_dump = run_metrics.interval;
+    while(des_pop(&des_events, &e) && e.t <= duration){
+        des_clock = e.t;
+        if (run_metrics.enabled && des_clock >= next_dump){
+            mt_dump(&run_metrics);  /* Dumping the metrics periodically in virtual time */
+            next_dump += run_metrics.interval;
+        }
+        if (e.kind == DES_EV_DETECT){
+            trigger.checks += 1;
+            detection_pass();
+            des_wake(); /* The terminated threads and the waiters of their instances */
+            des_schedule(des_clock + d_check_interval, DES_EV_DETECT, -1);
+        }else{
+            des_step(e.who);
+        }
+    }
+    des_clock = duration;
+
+    des_destroy(&des_events);
+    free(des_phase);
+    free(des_acq);
+    free(des_acquired);
+    free(des_ri);
+    free(des_blocked);
+}
+
+/*
+ * M:N mode: the workers are the state machines of the discrete-event simulation, run in real time as tasks of a
+ * work-stealing pool(task_pool.h) with as many threads as cores, instead of one thread each. A pause or a holding time
+ * puts the task to sleep on a timer, and a task whose request does not fit parks in the wait queue of the resource
+ * type: its waiter wakes it by submitting it to the pool instead of signalling a condition variable. The locking, the
+ * wait queues and the detector thread are those of the threaded mode.
+ */
+int *task_phase = NULL; /* Phase of every task, as in the discrete-event simulation */
+bool *task_acq = NULL;  /* Row t: whether the request of task t for every resource type is complete */
+int *task_acquired = NULL;  /* Number of complete resource types of every task */
+int *task_ri = NULL;    /* Resource type of the last request of every task */
+uint64_t *task_parked = NULL;   /* Time at which every task parked, for the metrics */
+
+void task_sleep(int t, double sec){
+    if (!tp_sleep(&tasks, t, sec)){
+        log_msg("Failed to allocate the timers of the task pool.", true);
+    }
+}
+
+/**
+ * Function called, with the lock of the queue held, when the waiter of a parked task is woken.
+ */
+void task_wake(wq_waiter *w){
+    tp_submit(&tasks, w->thr);
+}
+
+/**
+ * Function to allocate the current request of a task, as acquire_rcs() does, parking the task instead of waiting.
+ * @param n Number of instances requested, unused when the task was woken
+ * @param requeue The task was parked and has been woken
+ */
+void task_acquire(int t, int n, bool requeue){
+    int ri = task_ri[t];
+    lt_lock_rcs(&locks, ri);
+    uint64_t held = mt_start(&run_metrics);
+    if (requeue)
+        mt_record(&run_metrics, t, MH_COND_WAIT, task_parked[t]);
+    else
+        cur_request[t][ri] = min(n, request[t][ri]);
+    if (cur_request[t][ri] > available_rcs[ri] || (avoidance && !grant_is_safe(t, ri))){
+        if (!requeue){
+            trig_block(&trigger, t);
+            if (wfg_mode && wfg_block(&wfg, t, ri))
+                trig_fire(&trigger);
+        }
+        mt_record(&run_metrics, t, MH_LOCK_HOLD, held);
+        task_parked[t] = mt_start(&run_metrics);
+        task_phase[t] = DES_BLOCKED;
+        if (cur_request[t][ri] > available_rcs[ri]){
+            if (requeue)
+                wq_wake(&rcs_queues[ri], available_rcs[ri]);    /* The wake-up is passed on, as in acquire_rcs() */
+            wq_push(&rcs_queues[ri], &waiters[t], cur_request[t][ri], requeue);
+        }else{
+            unsafe_grants += 1;
+            wq_wake(&rcs_queues[ri], available_rcs[ri]);
+            wq_push(&unsafe_queue, &waiters[t], 0, false);
+        }
+        lt_unlock_rcs(&locks, ri);  /* From here on, a wake-up may run the task on another worker */
+        return;
+    }
+    if (requeue){
+        trig_unblock(&trigger, t);
+        if (wfg_mode)
+            wfg_unblock(&wfg, t);
+    }
+    if (grant_rcs(t, ri) == 0){
+        task_acquired[t] += 1;
+        task_acq[t * total_types_rcs + ri] = true;
+    }
+    mt_record(&run_metrics, t, MH_LOCK_HOLD, held);
+    lt_unlock_rcs(&locks, ri);
+    task_phase[t] = DES_REQUEST;
+    task_sleep(t, request_pause(t));
+}
+
+/**
+ * Function to run a task until it sleeps or parks, as thread_simulator() would run between two pauses.
+ */
+void task_step(int t){
+    bool *acq = &task_acq[t * total_types_rcs];
+    switch(task_phase[t]){
+        case DES_START:
+            task_acquired[t] = new_request_set(t, acq);
+            task_phase[t] = DES_REQUEST;
+            /* Falls through */
+        case DES_REQUEST:
+            if (task_acquired[t] >= total_types_rcs){
+                task_phase[t] = DES_RELEASE;
+                task_sleep(t, hold_time(t));
+                return;
+            }
+            int n = next_request(t, acq, &task_ri[t]);
+            task_acquire(t, n, false);
+            return;
+        case DES_BLOCKED:
+            task_acquire(t, 0, true);
+            return;
+        case DES_RELEASE:
+            release_all_rcs(t);
+            EVLOG(&evlog, EVLOG_ALL, t, EV_RESTART, t, -1, 0);
+            task_phase[t] = DES_START;
+            tp_submit(&tasks, t);
+            return;
+    }
+}
+
+/**
+ * Function to start the workers as tasks on a pool of threads, and the deadlock detector thread.
+ * @param n_workers Number of threads of the pool
+ */
+void createAllTasks(int n_workers){
+    start_time = sim_now();
+    task_phase = (int *)calloc(max_threads, sizeof(int));
+    task_acq = (bool *)calloc((size_t)max_threads * total_types_rcs, sizeof(bool));
+    task_acquired = (int *)calloc(max_threads, sizeof(int));
+    task_ri = (int *)calloc(max_threads, sizeof(int));
+    task_parked = (uint64_t *)calloc(max_threads, sizeof(uint64_t));
+    if (task_phase == NULL || task_acq == NULL || task_acquired == NULL || task_ri == NULL || task_parked == NULL ||
+        !tp_init(&tasks, n_workers, max_threads, task_step)){
+        log_msg("Failed to allocate the task pool.", true);
+    }
+    for(int t = 0; t < max_threads; t++){
+        waiters[t].on_wake = task_wake;
+        tp_submit(&tasks, t);
+    }
+    if (!tp_start(&tasks)){
+        log_msg("Failed to create the threads of the task pool.", true);
+    }
+    int rc = pthread_create(&detector_thr_id, NULL, dlock_detection_thr, NULL);
+    if (rc) {
+        log_msg("Failed to create the deadlock detector thread.", true);
+    }
+    pthread_join(detector_thr_id, NULL);
+}
+
+/* Outcome of one simulation run, sent by the child process of a comparison to its parent */
+typedef struct {
+    int heuristic;
+    unsigned int seed;
+    int dlocks;
+    double time_btw_dlocks;
+    int victims;
+    long lost_instances;
+    double lost_time;
+    long sets_done;
+    double sets_time;
+} run_result;
+
+/**
+ * Function to compare the heuristics on identical workloads: every heuristic is simulated in virtual time for the same
+ * n_seeds seeds, starting from the run's seed, in child processes forked from the initialised state, at most jobs at a
+ * time. A table of the averages over the seeds is printed.
+ * @param n_seeds Number of seeds
+ * @param jobs Maximum number of child processes running at once
+ */
+void compare_heuristics(int n_seeds, int jobs){
+    int n_runs = 5 * n_seeds;
+    run_result *results = (run_result *)malloc(sizeof(run_result) * n_runs);
+    pid_t *pids = (pid_t *)malloc(sizeof(pid_t) * n_runs);
+    int *fds = (int *)malloc(sizeof(int) * n_runs);
+    if (results == NULL || pids == NULL || fds == NULL){
+        log_msg("Failed to allocate the comparison.", true);
+    }
+    int started = 0, running = 0, done = 0;
+    fflush(stdout);
+    while(done < n_runs){
+        while(running < jobs && started < n_runs){
+            int pfd[2];
+            if (pipe(pfd) != 0){
+                log_msg("Failed to create a pipe.", true);
+            }
+            int r = started;
+            pid_t pid = fork();
+            if (pid < 0){
+                log_msg("Failed to fork a simulation.", true);
+            }
+            if (pid == 0){
+                /* Child: one run of a heuristic on a seed */
+                close(pfd[0]);
+                run_result res = {r % 5 + 1, seed + r / 5, 0, 0, 0, 0, 0, 0, 0};
+                heuristic_no = res.heuristic;
+                seed = res.seed;
+                evlog.level = EVLOG_OFF;
+                srand(seed);
+                for (int i = 0; i < max_threads; i++){
+                    thr_seeds[i] = rand();
+                }
+                des_run(exec_time);
+                res.dlocks = total_dlocks;
+                res.time_btw_dlocks = (total_dlocks > 0) ? total_time_btw_dlocks / total_dlocks : 0;
+                res.victims = total_victims;
+                res.lost_instances = lost_instances;
+                res.lost_time = lost_time;
+                for (int i = 0; i < max_threads; i++){
+                    res.sets_done += set_done[i];
+                    res.sets_time += set_time[i];
+                }
+                ssize_t w = write(pfd[1], &res, sizeof(res));
+                _exit(w == (ssize_t)sizeof(res) ? 0 : 1);
+            }
+            close(pfd[1]);
+            pids[r] = pid;
+            fds[r] = pfd[0];
+            started += 1;
+            running += 1;
+        }
+        int status;
+        pid_t pid = wait(&status);
+        if (pid < 0){
+            log_msg("Failed to wait for a simulation.", true);
+        }
+        for(int r = 0; r < started; r++){
+            if (pids[r] != pid)
+                continue;
+            if (read(fds[r], &results[r], sizeof(run_result)) != (ssize_t)sizeof(run_result)){
+                log_msg("A simulation failed.", true);
+            }
+            close(fds[r]);
+            running -= 1;
+            done += 1;
+        }
+    }
+
+    printf("Heuristic comparison over %d seeds(%u to %u), %d sec of virtual time each:\n", n_seeds, seed,
+           seed + n_seeds - 1, exec_time);
+    printf("%-10s %12s %22s %18s %16s %16s %14s %10s\n", "heuristic", "deadlocks", "avg_time_btw_dlocks",
+           "victims_per_dlock", "lost_instances", "lost_work_sec", "sets_per_sec", "goodput");
+    for(int h = 1; h <= 5; h++){
+        double dlocks = 0, time_btw = 0, victims = 0, instances = 0, work = 0, sets = 0, useful = 0;
+        for(int r = h - 1; r < n_runs; r += 5){
+            dlocks += results[r].dlocks;
+            time_btw += results[r].time_btw_dlocks;
+            victims += results[r].victims;
+            instances += results[r].lost_instances;
+            work += results[r].lost_time;
+            sets += results[r].sets_done;
+            useful += results[r].sets_time;
+        }
+        /* Throughput and goodput: the share of the time spent on request sets that went to completed ones */
+        printf("%-10d %12.1f %22.3f %18.2f %16.1f %16.1f %14.3f %10.3f\n", h, dlocks / n_seeds, time_btw / n_seeds,
+               (dlocks > 0) ? victims / dlocks : 0, instances / n_seeds, work / n_seeds,
+               sets / n_seeds / exec_time, (useful + work > 0) ? useful / (useful + work) : 0);
+    }
+    free(results);
+    free(pids);
+    free(fds);
+}
@@ -0,0 +1,83 @@
+#ifndef ALLOC_STATS_H
+#define ALLOC_STATS_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "simd_kernels.h"
+
+/**
+ * Per-thread aggregates of the allocation matrix: total instances held, and the largest and smallest allocation of any
+ * resource type. They are updated with every change of a cell, so that the victim selection heuristics read them in
+ * O(1) per deadlocked thread instead of scanning the rows. Raising a cell above the maximum or lowering it below the
+ * minimum is O(1); only lowering the cell that held the maximum, or raising the one that held the minimum, rescans the
+ * row. A thread's aggregates are written under the same locks as the cell that changed.
+ */
+typedef struct {
+    int n_thr, n_rcs;
+    int *total;
+    int *max;
+    int *min;
+} alloc_stats;
+
+static inline bool as_init(alloc_stats *as, int n_thr, int n_rcs){
+    as->n_thr = n_thr;
+    as->n_rcs = n_rcs;
+    as->total = (int *)calloc(n_thr > 0 ? n_thr : 1, sizeof(int));
+    as->max = (int *)calloc(n_thr > 0 ? n_thr : 1, sizeof(int));
+    as->min = (int *)calloc(n_thr > 0 ? n_thr : 1, sizeof(int));
+    return as->total != NULL && as->max != NULL && as->min != NULL;
+}
+
+static void as_destroy(alloc_stats *as){
+    free(as->total);
+    free(as->max);
+    free(as->min);
+    as->total = as->max = as->min = NULL;
+}
+
+/**
+ * Function to tell whether the aggregates are maintained.
+ */
+static inline bool as_enabled(const alloc_stats *as){
+    return as->total != NULL;
+}
+
+/**
+ * Function to recompute the aggregates of a thread from its whole allocation row, after the row was overwritten.
+ */
+static inline void as_rebuild(alloc_stats *as, int t, const int *row){
+    as->total[t] = row_sum(row, as->n_rcs);
+    as->max[t] = row_max(row, as->n_rcs);
+    as->min[t] = row_min(row, as->n_rcs);
+}
+
+/**
+ * Function to update the aggregates of a thread after a cell of its allocation row changed.
+ * @param row Allocation row of the thread, already holding the new value
+ * @param ri Index of the resource type that changed
+ * @param old Previous value of the cell
+ */
+static void as_update(alloc_stats *as, int t, const int *row, int ri, int old){
+    int val = row[ri];
+    if(val == old)
+        return;
+    as->total[t] += val - old;
+    if(val > as->max[t])
+        as->max[t] = val;
+    else if(old == as->max[t])
+        as->max[t] = row_max(row, as->n_rcs);   /* The maximum may have been lowered */
+    if(val < as->min[t])
+        as->min[t] = val;
+    else if(old == as->min[t])
+        as->min[t] = row_min(row, as->n_rcs);   /* The minimum may have been raised */
+}
+
+/**
+ * Function to reset the aggregates of a thread whose allocation row was cleared.
+ */
+static void as_clear(alloc_stats *as, int t){
+    as->total[t] = as->max[t] = as->min[t] = 0;
+}
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#define AR_ALIGN 64 /* Alignment of every allocation, in bytes */
+
+/* Block of an arena, followed by its memory */
+typedef struct ar_block {
+    struct ar_block *next;
+    size_t cap, used;
+} ar_block;
+
+/**
+ * Scratch arena for the temporaries of a pass, instead of variable-length arrays on the stack: allocations are carved
+ * out of large blocks, and freed all at once by ar_reset(), or back to a mark by ar_restore(). Blocks are added when the
+ * current one is full, so earlier allocations never move; ar_reset() then replaces them with a single block as large as
+ * the most memory ever in use, so that the following passes take no memory from the heap at all. Not thread-safe: every
+ * arena belongs to one thread, or to the holder of a lock.
+ */
+typedef struct {
+    ar_block *head; /* Block allocations are taken from, followed by the earlier ones */
+    size_t in_use;  /* Memory allocated and not freed, in bytes */
+    size_t high;    /* Most memory ever in use */
+} arena;
+
+/* Position in an arena, to free everything allocated after it */
+typedef struct {
+    ar_block *block;
+    size_t used;
+} ar_mark;
+
+static inline void ar_init(arena *ar){
+    ar->head = NULL;
+    ar->in_use = ar->high = 0;
+}
+
+static size_t ar_round(size_t n){
+    return (n + AR_ALIGN - 1) / AR_ALIGN * AR_ALIGN;
+}
+
+static bool ar_grow(arena *ar, size_t bytes){
+    size_t cap = ar_round(bytes);
+    if(ar->head != NULL && cap < 2 * ar->head->cap)
+        cap = 2 * ar->head->cap;
+    ar_block *b = (ar_block *)aligned_alloc(AR_ALIGN, ar_round(sizeof(ar_block)) + cap);
+    if(b == NULL)
+        return false;
+    b->next = ar->head;
+    b->cap = cap;
+    b->used = 0;
+    ar->head = b;
+    return true;
+}
+
+/**
+ * Function to allocate uninitialised memory from an arena, aligned to AR_ALIGN bytes.
+ * @return Return the memory, or NULL if a block could not be allocated.
+ */
+static void* ar_alloc(arena *ar, size_t bytes){
+    bytes = ar_round(bytes > 0 ? bytes : 1);
+    if((ar->head == NULL || ar->head->used + bytes > ar->head->cap) && !ar_grow(ar, bytes))
+        return NULL;
+    void *p = (char *)ar->head + ar_round(sizeof(ar_block)) + ar->head->used;
+    ar->head->used += bytes;
+    ar->in_use += bytes;
+    if(ar->in_use > ar->high)
+        ar->high = ar->in_use;
+    return p;
+}
+
+static ar_mark ar_save(const arena *ar){
+    ar_mark m = {ar->head, (ar->head != NULL) ? ar->head->used : 0};
+    if(ar->in_use == 0)
+        m.block = NULL;     /* Nothing to keep: restoring the mark resets the arena */
+    return m;
+}
+
+static void ar_release(arena *ar, ar_mark m){
+    while(ar->head != m.block){
+        ar_block *b = ar->head;
+        ar->head = b->next;
+        ar->in_use -= b->used;
+        free(b);
+    }
+    if(ar->head != NULL){
+        ar->in_use -= ar->head->used - m.used;
+        ar->head->used = m.used;
+    }
+}
+
+/**
+ * Function to free everything allocated from an arena, keeping one block as large as the most memory ever in use.
+ */
+static void ar_reset(arena *ar){
+    if(ar->head != NULL && ar->head->next == NULL && ar->head->cap >= ar->high){
+        ar->head->used = 0;
+        ar->in_use = 0;
+        return;
+    }
+    ar_mark none = {NULL, 0};
+    ar_release(ar, none);
+    if(ar->high > 0)
+        ar_grow(ar, ar->high);
+}
+
+/**
+ * Function to free everything allocated from an arena since a mark. A mark taken on an empty arena resets it, so that
+ * a pass that only saves and restores marks keeps a single block from one call to the next.
+ */
+static void ar_restore(arena *ar, ar_mark m){
+    if(m.block == NULL)
+        ar_reset(ar);
+    else
+        ar_release(ar, m);
+}
+
+static void ar_destroy(arena *ar){
+    ar_mark none = {NULL, 0};
+    ar_release(ar, none);
+    ar->high = 0;
+}
+
+#endif
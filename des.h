@@ -0,0 +1,90 @@
+#ifndef DES_H
+#define DES_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+/**
+ * Event queue of the discrete-event simulation: a binary min-heap ordered by virtual time. Events at the same time are
+ * ordered by insertion, so that a run only depends on its seed.
+ */
+typedef struct {
+    double t;   /* Virtual time, in seconds */
+    long seq;   /* Insertion number, breaking ties */
+    int kind;
+    int who;    /* Thread the event belongs to, -1 for the detector */
+} des_event;
+
+typedef struct {
+    des_event *heap;
+    int len, cap;
+    long next_seq;
+} des_queue;
+
+static bool des_init(des_queue *q, int cap){
+    q->len = 0;
+    q->next_seq = 0;
+    q->cap = (cap > 0) ? cap : 16;
+    q->heap = (des_event *)malloc(sizeof(des_event) * q->cap);
+    return q->heap != NULL;
+}
+
+static void des_destroy(des_queue *q){
+    free(q->heap);
+    q->heap = NULL;
+    q->len = q->cap = 0;
+}
+
+static bool des_before(const des_event *a, const des_event *b){
+    return (a->t < b->t) || (a->t == b->t && a->seq < b->seq);
+}
+
+/**
+ * Function to schedule an event.
+ * @return Return false if the queue could not grow.
+ */
+static bool des_push(des_queue *q, double t, int kind, int who){
+    if(q->len == q->cap){
+        des_event *grown = (des_event *)realloc(q->heap, sizeof(des_event) * q->cap * 2);
+        if(grown == NULL)
+            return false;
+        q->heap = grown;
+        q->cap *= 2;
+    }
+    des_event e = {t, q->next_seq++, kind, who};
+    int i = q->len++;
+    while(i > 0 && des_before(&e, &q->heap[(i - 1) / 2])){
+        q->heap[i] = q->heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    q->heap[i] = e;
+    return true;
+}
+
+/**
+ * Function to remove the earliest event.
+ * @return Return false if the queue is empty.
+ */
+static bool des_pop(des_queue *q, des_event *out){
+    if(q->len == 0)
+        return false;
+    *out = q->heap[0];
+    des_event last = q->heap[--q->len];
+    int i = 0;
+    while(true){
+        int c = 2 * i + 1;
+        if(c >= q->len)
+            break;
+        if(c + 1 < q->len && des_before(&q->heap[c + 1], &q->heap[c]))
+            c += 1;
+        if(!des_before(&q->heap[c], &last))
+            break;
+        q->heap[i] = q->heap[c];
+        i = c;
+    }
+    if(q->len > 0)
+        q->heap[i] = last;
+    return true;
+}
+
+#endif
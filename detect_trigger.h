@@ -0,0 +1,210 @@
+#ifndef DETECT_TRIGGER_H
+#define DETECT_TRIGGER_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * Triggering of the deadlock detection.
+ * Besides the periodic check, a check is triggered as soon as the number of blocked threads reaches block_threshold, or
+ * as soon as a thread has been blocked for block_time seconds, once per blocking episode. Triggered checks are never
+ * closer than min_interval.
+ * With adaptive set, the period is halved after a check that found a deadlock and doubled after a clean one, within
+ * [min_interval, max_interval].
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;    /* Signalled when a trigger fires */
+    int n_thr;
+    int blocked;    /* Number of threads currently blocked, updated atomically */
+    uint64_t *block_start;  /* Time at which each thread blocked, in ns, 0 if it is not blocked */
+    bool pending;   /* A trigger fired since the last check */
+    uint64_t fired_until;   /* Blocking episodes started at or before this time already triggered a check */
+
+    int block_threshold;    /* 0 disables the trigger on the number of blocked threads */
+    double block_time;  /* 0 disables the trigger on the time spent blocked */
+    bool adaptive;
+    double interval;    /* Current period, in seconds */
+    double min_interval, max_interval;
+    uint64_t last_check;    /* Time of the last check, in ns */
+
+    long checks;    /* Number of checks */
+    long clean_checks;  /* Number of checks that found no deadlock */
+    long triggered_checks;  /* Number of checks started by a trigger rather than by the period */
+    double total_latency;   /* Sum of the times between the formation and the detection of the deadlocks, in seconds */
+    long latency_samples;
+} detect_trigger;
+
+static uint64_t trig_now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline bool trig_init(detect_trigger *tr, int n_thr, double interval, int block_threshold, double block_time,
+                      bool adaptive){
+    pthread_mutex_init(&tr->lock, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&tr->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    tr->n_thr = n_thr;
+    tr->blocked = 0;
+    tr->pending = false;
+    tr->fired_until = 0;
+    tr->block_start = (uint64_t *)calloc(n_thr > 0 ? n_thr : 1, sizeof(uint64_t));
+    tr->block_threshold = block_threshold;
+    tr->block_time = block_time;
+    tr->adaptive = adaptive;
+    tr->interval = interval;
+    tr->min_interval = interval / 8;
+    tr->max_interval = interval * 4;
+    tr->last_check = trig_now();
+    tr->checks = tr->clean_checks = tr->triggered_checks = 0;
+    tr->total_latency = 0;
+    tr->latency_samples = 0;
+    return tr->block_start != NULL;
+}
+
+static inline void trig_destroy(detect_trigger *tr){
+    pthread_mutex_destroy(&tr->lock);
+    pthread_cond_destroy(&tr->cond);
+    free(tr->block_start);
+    tr->block_start = NULL;
+}
+
+static void trig_fire(detect_trigger *tr){
+    pthread_mutex_lock(&tr->lock);
+    tr->pending = true;
+    pthread_cond_signal(&tr->cond);
+    pthread_mutex_unlock(&tr->lock);
+}
+
+/**
+ * Function called by a thread about to block on a resource.
+ */
+static void trig_block(detect_trigger *tr, int thr){
+    if(tr->block_start == NULL)
+        return;
+    __atomic_store_n(&tr->block_start[thr], trig_now(), __ATOMIC_RELAXED);
+    int blocked = __atomic_add_fetch(&tr->blocked, 1, __ATOMIC_RELAXED);
+    if(tr->block_threshold > 0 && blocked >= tr->block_threshold)
+        trig_fire(tr);
+}
+
+/**
+ * Function called by a thread that is no longer blocked.
+ */
+static void trig_unblock(detect_trigger *tr, int thr){
+    if(tr->block_start == NULL)
+        return;
+    __atomic_store_n(&tr->block_start[thr], 0, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&tr->blocked, 1, __ATOMIC_RELAXED);
+}
+
+static struct timespec trig_abs(uint64_t ns){
+    struct timespec ts;
+    ts.tv_sec = ns / 1000000000ull;
+    ts.tv_nsec = ns % 1000000000ull;
+    return ts;
+}
+
+/**
+ * Function to wait until the next check is due: the period has elapsed, or a trigger fired and at least min_interval
+ * has passed since the last check.
+ * @return Return true if the check was started by a trigger.
+ */
+static bool trig_wait(detect_trigger *tr){
+    pthread_mutex_lock(&tr->lock);
+    bool triggered = false;
+    uint64_t covered = tr->fired_until;
+    while(true){
+        uint64_t now = trig_now();
+        uint64_t due = tr->last_check + (uint64_t)(tr->interval * 1e9);
+        uint64_t earliest = tr->last_check + (uint64_t)(tr->min_interval * 1e9);
+        if(now >= due)
+            break;
+        if(tr->block_time > 0){
+            /* The oldest blocked thread decides when the blocked-time trigger fires; a thread still blocked in the
+            episode that already triggered a check, waiting on a live holder, does not trigger another one */
+            uint64_t oldest = 0, block_ns = (uint64_t)(tr->block_time * 1e9);
+            for(int i = 0; i < tr->n_thr; i++){
+                uint64_t b = __atomic_load_n(&tr->block_start[i], __ATOMIC_RELAXED);
+                if(b > tr->fired_until && (oldest == 0 || b < oldest))
+                    oldest = b;
+            }
+            if(oldest != 0){
+                uint64_t fire = oldest + block_ns;
+                if(fire <= now){
+                    tr->pending = true;
+                    covered = now - block_ns;   /* Every episode started by then has reached block_time */
+                }else if(fire < due)
+                    due = fire;
+            }
+        }
+        if(tr->pending){
+            if(now >= earliest){
+                triggered = true;
+                break;
+            }
+            due = earliest;
+        }
+        struct timespec until = trig_abs(due);
+        pthread_cond_timedwait(&tr->cond, &tr->lock, &until);
+    }
+    tr->pending = false;
+    tr->fired_until = covered;
+    tr->last_check = trig_now();
+    tr->checks += 1;
+    if(triggered)
+        tr->triggered_checks += 1;
+    pthread_mutex_unlock(&tr->lock);
+    return triggered;
+}
+
+/**
+ * Function to report the outcome of a check, adapting the period if enabled.
+ * @param found_dlock Whether the check found a deadlock
+ */
+static void trig_feedback(detect_trigger *tr, bool found_dlock){
+    pthread_mutex_lock(&tr->lock);
+    if(!found_dlock)
+        tr->clean_checks += 1;
+    if(tr->adaptive){
+        if(found_dlock)
+            tr->interval = (tr->interval / 2 > tr->min_interval) ? tr->interval / 2 : tr->min_interval;
+        else
+            tr->interval = (tr->interval * 2 < tr->max_interval) ? tr->interval * 2 : tr->max_interval;
+    }
+    pthread_mutex_unlock(&tr->lock);
+}
+
+/**
+ * Function to record the time to detection of a deadlock: a deadlock forms when the last of its threads blocks, so the
+ * latest block time among the deadlocked threads that are blocked is taken as the time of formation.
+ * @param thr_in_dlock Indexes of the threads in deadlock
+ * @param k Number of threads in deadlock
+ */
+static void trig_record_latency(detect_trigger *tr, const int thr_in_dlock[], int k){
+    if(tr->block_start == NULL)
+        return;
+    uint64_t formed = 0;
+    for(int i = 0; i < k; i++){
+        uint64_t b = __atomic_load_n(&tr->block_start[thr_in_dlock[i]], __ATOMIC_RELAXED);
+        if(b > formed)
+            formed = b;
+    }
+    if(formed == 0)
+        return;
+    uint64_t now = trig_now();
+    if(now > formed){
+        tr->total_latency += (now - formed) * 1e-9;
+        tr->latency_samples += 1;
+    }
+}
+
+#endif
@@ -0,0 +1,302 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Asynchronous event log.
+ * Every producer (worker thread or detector) appends compact binary records to its own single-producer ring buffer,
+ * without locks or system calls; when its ring is full the record is dropped and counted. A writer thread drains the
+ * rings, merges the records by timestamp and either formats them as the usual text lines or writes them to a binary file.
+ *
+ * Verbosity: EVLOG_DETECTOR logs the detector, EVLOG_ALL also logs every allocation and release. EVLOG_MAX_LEVEL caps the
+ * level at compile time, e.g. -DEVLOG_MAX_LEVEL=0 compiles all logging out.
+ */
+
+#define EVLOG_OFF 0
+#define EVLOG_DETECTOR 1
+#define EVLOG_ALL 2
+
+#ifndef EVLOG_MAX_LEVEL
+#define EVLOG_MAX_LEVEL EVLOG_ALL
+#endif
+
+#define EVLOG_MAGIC 0x56454c44u  /* "DLEV" */
+
+/* Kinds of events */
+enum {
+    EV_ALLOCATE = 1,    /* count instances of rcs allocated to thr */
+    EV_RELEASE,         /* count instances of rcs released by thr */
+    EV_RESTART,         /* thr restarts with a new request set */
+    EV_DETECT_START,    /* The detector starts a pass */
+    EV_DLOCK_FOUND,     /* A deadlock of count threads, followed by count EV_DLOCK_MEMBER records */
+    EV_DLOCK_MEMBER,    /* thr is the rcs-th of the count threads in deadlock */
+    EV_TERMINATE,       /* thr is terminated */
+    EV_RESOLVED,        /* The deadlock is resolved */
+    EV_NO_DLOCK,        /* The pass found no deadlock */
+    EV_DEFERRED         /* The state changed since the snapshot, resolution deferred */
+};
+
+typedef struct {
+    uint64_t ts;    /* CLOCK_MONOTONIC, in ns */
+    int32_t thr;
+    int32_t rcs;
+    int32_t count;
+    uint32_t kind;
+} ev_record;
+
+/* Single-producer single-consumer ring */
+typedef struct {
+    ev_record *buf;
+    uint32_t mask;
+    uint64_t head __attribute__((aligned(64)));    /* Written by the producer */
+    uint64_t tail __attribute__((aligned(64)));    /* Written by the consumer */
+    uint64_t dropped;
+} ev_ring;
+
+typedef struct {
+    int n_rings;
+    ev_ring *rings;
+    int level;  /* Runtime verbosity, at most EVLOG_MAX_LEVEL */
+    bool binary;    /* Write the raw records instead of text */
+    FILE *out;
+    bool running;
+    pthread_t writer;
+    pthread_mutex_t drain_lock; /* Serialises the consumers: the writer thread and evlog_flush() */
+    ev_record *batch;   /* Scratch for the merge */
+    ev_record *merged;
+    size_t *runs;   /* Start of the run of every ring in batch, plus the end */
+} event_log;
+
+/* Emit an event if the level is enabled, at compile time and at runtime */
+#define EVLOG(log, lvl, producer, kind, thr, rcs, count) \
+    do { \
+        if (EVLOG_MAX_LEVEL >= (lvl) && (log)->level >= (lvl)) \
+            evlog_emit((log), (producer), (kind), (thr), (rcs), (count)); \
+    } while (0)
+
+static uint64_t evlog_now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t evlog_pow2(uint32_t n){
+    uint32_t p = 64;
+    while(p < n)
+        p <<= 1;
+    return p;
+}
+
+/**
+ * Function to set up the log.
+ * @param log Log to initialise
+ * @param n_rings Number of producers; producer i appends to ring i
+ * @param capacity Capacity of the rings, in records
+ * @param last_capacity Capacity of the last ring, used by the detector which emits one record per deadlocked thread
+ * @param level Verbosity
+ * @param out Destination of the records
+ * @param binary Write binary records instead of text
+ * @return Return true on success.
+ */
+static inline bool evlog_init(event_log *log, int n_rings, uint32_t capacity, uint32_t last_capacity, int level, FILE *out,
+                       bool binary){
+    memset(log, 0, sizeof(*log));
+    log->n_rings = n_rings;
+    log->level = (level > EVLOG_MAX_LEVEL) ? EVLOG_MAX_LEVEL : level;
+    log->out = out;
+    log->binary = binary;
+    pthread_mutex_init(&log->drain_lock, NULL);
+    if(log->level == EVLOG_OFF){
+        /* Nothing is ever emitted: no ring is allocated, which matters with very many producers */
+        log->n_rings = 0;
+        return true;
+    }
+    log->rings = (ev_ring *)aligned_alloc(64, ((sizeof(ev_ring) * n_rings + 63) / 64) * 64);
+    log->runs = (size_t *)calloc(n_rings + 1, sizeof(size_t));
+    if(log->rings == NULL || log->runs == NULL)
+        return false;
+    memset(log->rings, 0, sizeof(ev_ring) * n_rings);
+    size_t total = 0;
+    for(int i = 0; i < n_rings; i++){
+        uint32_t cap = evlog_pow2((i == n_rings - 1) ? last_capacity : capacity);
+        log->rings[i].buf = (ev_record *)malloc(sizeof(ev_record) * cap);
+        if(log->rings[i].buf == NULL)
+            return false;
+        log->rings[i].mask = cap - 1;
+        total += cap;
+    }
+    log->batch = (ev_record *)malloc(sizeof(ev_record) * total);
+    log->merged = (ev_record *)malloc(sizeof(ev_record) * total);
+    if(log->batch == NULL || log->merged == NULL)
+        return false;
+    if(binary){
+        uint32_t header[4] = {EVLOG_MAGIC, 1, (uint32_t)n_rings, (uint32_t)sizeof(ev_record)};
+        fwrite(header, sizeof(header), 1, out);
+    }
+    return true;
+}
+
+static void evlog_format(FILE *out, const ev_record *e){
+    switch(e->kind){
+        case EV_ALLOCATE: fprintf(out, "Allocate %d number of instances of resource type %d to thread %d\n", e->count, e->rcs, e->thr);
+                break;
+        case EV_RELEASE: fprintf(out, "Release %d number of instances of resource type %d from thread %d\n", e->count, e->rcs, e->thr);
+                break;
+        case EV_RESTART: fprintf(out, "Restarting thread %d\n", e->thr);
+                break;
+        case EV_DETECT_START: fprintf(out, "\nLOG: Deadlock detection started...\n");
+                break;
+        case EV_DLOCK_FOUND: fprintf(out, "LOG: Deadlock Detected. Threads in deadlock are: ");
+                if(e->count == 0) fprintf(out, "\n");
+                break;
+        case EV_DLOCK_MEMBER: fprintf(out, "%d ", e->thr);
+                if(e->rcs == e->count - 1) fprintf(out, "\n");
+                break;
+        case EV_TERMINATE: fprintf(out, "LOG: Terminating thread %d and retrying...\n", e->thr);
+                break;
+        case EV_RESOLVED: fprintf(out, "LOG: Deadlock Resolved.\n\n");
+                break;
+        case EV_NO_DLOCK: fprintf(out, "LOG: No Deadlock.\n\n");
+                break;
+        case EV_DEFERRED: fprintf(out, "LOG: State changed since the snapshot, resolution deferred to the next check.\n\n");
+                break;
+    }
+}
+
+/**
+ * Function to append an event to the ring of a producer. Never blocks: the event is dropped if the ring is full.
+ * When the writer is not running, the event is written synchronously instead.
+ */
+static void evlog_emit(event_log *log, int producer, uint32_t kind, int thr, int rcs, int count){
+    ev_record e = {evlog_now(), thr, rcs, count, kind};
+    if(!log->running){
+        if(log->out == NULL)
+            return;
+        if(log->binary) fwrite(&e, sizeof(e), 1, log->out);
+        else evlog_format(log->out, &e);
+        return;
+    }
+    ev_ring *r = &log->rings[producer];
+    uint64_t head = r->head;
+    if(head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) > r->mask){
+        __atomic_store_n(&r->dropped, r->dropped + 1, __ATOMIC_RELAXED);
+        return;
+    }
+    r->buf[head & r->mask] = e;
+    __atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Function to drain every ring once, writing the records merged by timestamp.
+ * @return Return the number of records written.
+ */
+static size_t evlog_drain(event_log *log){
+    pthread_mutex_lock(&log->drain_lock);
+    /* Copying the pending records of every ring as one run; each run is already in timestamp order */
+    size_t n = 0;
+    int n_runs = 0;
+    for(int i = 0; i < log->n_rings; i++){
+        ev_ring *r = &log->rings[i];
+        uint64_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        if(head == r->tail)
+            continue;
+        log->runs[n_runs++] = n;
+        for(uint64_t t = r->tail; t < head; t++){
+            log->batch[n++] = r->buf[t & r->mask];
+        }
+        __atomic_store_n(&r->tail, head, __ATOMIC_RELEASE);
+    }
+    log->runs[n_runs] = n;
+
+    /* Merging the runs pairwise until one is left. The merge is stable, so records of a ring keep their order. */
+    ev_record *src = log->batch, *dst = log->merged;
+    while(n_runs > 1){
+        int out_runs = 0;
+        for(int k = 0; k < n_runs; k += 2){
+            size_t a = log->runs[k], a_end = log->runs[k + 1];
+            size_t b = a_end, b_end = (k + 1 < n_runs) ? log->runs[k + 2] : a_end;
+            size_t o = a;
+            log->runs[out_runs++] = a;
+            while(a < a_end && b < b_end){
+                dst[o++] = (src[b].ts < src[a].ts) ? src[b++] : src[a++];
+            }
+            while(a < a_end) dst[o++] = src[a++];
+            while(b < b_end) dst[o++] = src[b++];
+        }
+        log->runs[out_runs] = n;
+        n_runs = out_runs;
+        ev_record *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    if(log->binary){
+        fwrite(src, sizeof(ev_record), n, log->out);
+    }else{
+        for(size_t i = 0; i < n; i++){
+            evlog_format(log->out, &src[i]);
+        }
+    }
+    if(n > 0)
+        fflush(log->out);
+    pthread_mutex_unlock(&log->drain_lock);
+    return n;
+}
+
+static void* evlog_writer(void *arg){
+    event_log *log = (event_log *)arg;
+    /* The signal handlers flush the log, so they must never interrupt the writer while it drains */
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGALRM);
+    sigaddset(&set, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+    struct timespec idle = {0, 1000000};
+    while(__atomic_load_n(&log->running, __ATOMIC_ACQUIRE)){
+        if(evlog_drain(log) == 0)
+            nanosleep(&idle, NULL);
+    }
+    return NULL;
+}
+
+static inline bool evlog_start(event_log *log){
+    if(log->rings == NULL)
+        return true;    /* The log is off */
+    __atomic_store_n(&log->running, true, __ATOMIC_RELEASE);
+    if(pthread_create(&log->writer, NULL, evlog_writer, log) != 0){
+        log->running = false;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Function to write out everything emitted so far, from any thread but the writer.
+ */
+static void evlog_flush(event_log *log){
+    if(log->rings != NULL)
+        evlog_drain(log);
+    if(log->out != NULL)
+        fflush(log->out);
+}
+
+/**
+ * Function to get the total number of records dropped because a ring was full.
+ */
+static uint64_t evlog_dropped(event_log *log){
+    uint64_t d = 0;
+    for(int i = 0; i < log->n_rings; i++){
+        d += __atomic_load_n(&log->rings[i].dropped, __ATOMIC_RELAXED);
+    }
+    return d;
+}
+
+#endif
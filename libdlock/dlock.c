@@ -0,0 +1,284 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dlock.h"
+#include "../alloc_stats.h"
+#include "../arena.h"
+#include "../simd_kernels.h"
+#include "../state_store.h"
+#include "../victim_select.h"
+#include "../worklist_dlock.h"
+
+/*
+ * The detector of the simulator, on the state of a context instead of globals: the same matrices(state_store.h), the
+ * same per-thread aggregates(alloc_stats.h), the same worklist reduction(worklist_dlock.h) resumed after every victim,
+ * and the same heuristics(victim_select.h).
+ */
+struct dlock_ctx {
+    pthread_mutex_t lock;   /* Serializes every call on the context */
+    int n_thr, n_rcs;
+    int heuristic;
+    state_store store;  /* allocation and request; cur_request is unused */
+    alloc_stats stats;
+    int *max_available;
+    int *available;
+    bool *registered;
+    int *free_slots;    /* Stack of the unregistered thread slots */
+    int n_free;
+
+    /* Scratch memory of the reduction */
+    int *work;
+    bool *finish;
+    int *thr_in_dlock;
+    arena scratch;  /* Lists of the worklist reduction, kept from one reduction to the next */
+
+    long checks, deadlocks, victims;
+};
+
+dlock_ctx *dlock_create(int max_threads, int n_rcs, const int *max_available, int heuristic){
+    if(max_threads <= 0 || n_rcs <= 0 || max_available == NULL || heuristic < DLOCK_MAX_TOTAL ||
+       heuristic > DLOCK_LINEAR)
+        return NULL;
+    for(int j = 0; j < n_rcs; j++){
+        if(max_available[j] < 0)
+            return NULL;
+    }
+    simd_init();
+    dlock_ctx *ctx = (dlock_ctx *)calloc(1, sizeof(dlock_ctx));
+    if(ctx == NULL)
+        return NULL;
+    ctx->n_thr = max_threads;
+    ctx->n_rcs = n_rcs;
+    ctx->heuristic = heuristic;
+    pthread_mutex_init(&ctx->lock, NULL);
+    ar_init(&ctx->scratch);
+    bool ok = ss_init_ex(&ctx->store, max_threads, n_rcs, false, false, true);
+    if(!ok)
+        memset(&ctx->store, 0, sizeof(ctx->store)); /* ss_init_ex() freed what it allocated */
+    ok = as_init(&ctx->stats, max_threads, n_rcs) && ok;
+    ctx->max_available = (int *)malloc(sizeof(int) * n_rcs);
+    ctx->available = (int *)malloc(sizeof(int) * n_rcs);
+    ctx->registered = (bool *)calloc(max_threads, sizeof(bool));
+    ctx->free_slots = (int *)malloc(sizeof(int) * max_threads);
+    ctx->work = (int *)malloc(sizeof(int) * n_rcs);
+    ctx->finish = (bool *)malloc(sizeof(bool) * max_threads);
+    ctx->thr_in_dlock = (int *)malloc(sizeof(int) * max_threads);
+    if(!ok || ctx->max_available == NULL || ctx->available == NULL || ctx->registered == NULL ||
+       ctx->free_slots == NULL || ctx->work == NULL || ctx->finish == NULL || ctx->thr_in_dlock == NULL){
+        dlock_destroy(ctx);
+        return NULL;
+    }
+    memcpy(ctx->max_available, max_available, sizeof(int) * n_rcs);
+    memcpy(ctx->available, max_available, sizeof(int) * n_rcs);
+    /* Slots are handed out from the lowest index */
+    ctx->n_free = max_threads;
+    for(int i = 0; i < max_threads; i++){
+        ctx->free_slots[i] = max_threads - 1 - i;
+    }
+    return ctx;
+}
+
+void dlock_destroy(dlock_ctx *ctx){
+    if(ctx == NULL)
+        return;
+    if(ctx->store.block != NULL)
+        ss_destroy(&ctx->store);
+    pthread_mutex_destroy(&ctx->lock);
+    as_destroy(&ctx->stats);
+    free(ctx->max_available);
+    free(ctx->available);
+    free(ctx->registered);
+    free(ctx->free_slots);
+    free(ctx->work);
+    free(ctx->finish);
+    free(ctx->thr_in_dlock);
+    ar_destroy(&ctx->scratch);
+    free(ctx);
+}
+
+static bool valid_thr(const dlock_ctx *ctx, int thr){
+    return thr >= 0 && thr < ctx->n_thr && ctx->registered[thr];
+}
+
+static bool valid_rcs(const dlock_ctx *ctx, int rcs){
+    return rcs >= 0 && rcs < ctx->n_rcs;
+}
+
+/**
+ * Function to release everything a thread holds and clear what it waits for.
+ * Must be called with the lock of the context held.
+ */
+static void clear_thr(dlock_ctx *ctx, int thr){
+    int *alloc = ctx->store.allocation[thr];
+    row_add(ctx->available, alloc, ctx->n_rcs);
+    memset(alloc, 0, sizeof(int) * ctx->n_rcs);
+    memset(ctx->store.request[thr], 0, sizeof(int) * ctx->n_rcs);
+    as_clear(&ctx->stats, thr);
+}
+
+int dlock_register_thread(dlock_ctx *ctx){
+    pthread_mutex_lock(&ctx->lock);
+    int thr = DLOCK_EFULL;
+    if(ctx->n_free > 0){
+        thr = ctx->free_slots[--ctx->n_free];
+        ctx->registered[thr] = true;
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    return thr;
+}
+
+int dlock_unregister_thread(dlock_ctx *ctx, int thr){
+    pthread_mutex_lock(&ctx->lock);
+    int ret = DLOCK_EINVAL;
+    if(valid_thr(ctx, thr)){
+        clear_thr(ctx, thr);
+        ctx->registered[thr] = false;
+        ctx->free_slots[ctx->n_free++] = thr;
+        ret = 0;
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    return ret;
+}
+
+int dlock_request(dlock_ctx *ctx, int thr, int rcs, int n){
+    pthread_mutex_lock(&ctx->lock);
+    int ret = DLOCK_EINVAL;
+    if(valid_thr(ctx, thr) && valid_rcs(ctx, rcs) && n >= 0){
+        ctx->store.request[thr][rcs] += n;
+        ret = 0;
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    return ret;
+}
+
+int dlock_grant(dlock_ctx *ctx, int thr, int rcs, int n){
+    pthread_mutex_lock(&ctx->lock);
+    int ret = DLOCK_EINVAL;
+    if(valid_thr(ctx, thr) && valid_rcs(ctx, rcs) && n >= 0){
+        ret = DLOCK_EAGAIN;
+        if(n <= ctx->available[rcs]){
+            int *alloc = ctx->store.allocation[thr];
+            int *req = ctx->store.request[thr];
+            int old = alloc[rcs];
+            ctx->available[rcs] -= n;
+            alloc[rcs] += n;
+            req[rcs] = (req[rcs] > n) ? req[rcs] - n : 0;
+            as_update(&ctx->stats, thr, alloc, rcs, old);
+            ret = 0;
+        }
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    return ret;
+}
+
+int dlock_release(dlock_ctx *ctx, int thr, int rcs, int n){
+    pthread_mutex_lock(&ctx->lock);
+    int ret = DLOCK_EINVAL;
+    if(valid_thr(ctx, thr) && valid_rcs(ctx, rcs) && n >= 0 && n <= ctx->store.allocation[thr][rcs]){
+        int *alloc = ctx->store.allocation[thr];
+        int old = alloc[rcs];
+        ctx->available[rcs] += n;
+        alloc[rcs] -= n;
+        as_update(&ctx->stats, thr, alloc, rcs, old);
+        ret = 0;
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    return ret;
+}
+
+int dlock_release_all(dlock_ctx *ctx, int thr){
+    pthread_mutex_lock(&ctx->lock);
+    int ret = DLOCK_EINVAL;
+    if(valid_thr(ctx, thr)){
+        clear_thr(ctx, thr);
+        ret = 0;
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    return ret;
+}
+
+int dlock_available(dlock_ctx *ctx, int rcs){
+    pthread_mutex_lock(&ctx->lock);
+    int ret = valid_rcs(ctx, rcs) ? ctx->available[rcs] : DLOCK_EINVAL;
+    pthread_mutex_unlock(&ctx->lock);
+    return ret;
+}
+
+/**
+ * Function to reduce the state of a context, from scratch or from the last reduction, and list the threads left in
+ * deadlock in ctx->thr_in_dlock, ended by -1.
+ * Must be called with the lock of the context held.
+ * @param resume The state only changed since the last reduction by the termination of threads now marked finished,
+ * whose allocation was added to ctx->work
+ * @return Return the number of threads in deadlock, or DLOCK_ENOMEM.
+ */
+static int reduce(dlock_ctx *ctx, bool resume){
+    if(!resume){
+        memcpy(ctx->work, ctx->available, sizeof(int) * ctx->n_rcs);
+        for(int i = 0; i < ctx->n_thr; i++){
+            ctx->finish[i] = (ctx->stats.max[i] <= 0);  /* Threads holding nothing are finished */
+        }
+    }
+    int unfinished = worklist_reduce(ctx->n_thr, ctx->n_rcs, ctx->store.allocation, ctx->store.request, NULL, 0,
+                                     ctx->work, ctx->finish, &ctx->scratch);
+    ar_reset(&ctx->scratch);    /* One block as large as the lists ever were: later reductions do not allocate */
+    if(unfinished < 0)
+        return DLOCK_ENOMEM;
+    int k = 0;
+    for(int i = 0; i < ctx->n_thr && k < unfinished; i++){
+        if(!ctx->finish[i])
+            ctx->thr_in_dlock[k++] = i;
+    }
+    if(k < ctx->n_thr)
+        ctx->thr_in_dlock[k] = -1;
+    return k;
+}
+
+int dlock_detect(dlock_ctx *ctx, int *thr_in_dlock){
+    pthread_mutex_lock(&ctx->lock);
+    ctx->checks += 1;
+    int k = reduce(ctx, false);
+    if(k > 0){
+        ctx->deadlocks += 1;
+        if(thr_in_dlock != NULL)
+            memcpy(thr_in_dlock, ctx->thr_in_dlock, sizeof(int) * k);
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    return k;
+}
+
+int dlock_resolve(dlock_ctx *ctx, int *victims){
+    pthread_mutex_lock(&ctx->lock);
+    ctx->checks += 1;
+    int k = reduce(ctx, false);
+    int n = 0;
+    if(k > 0)
+        ctx->deadlocks += 1;
+    while(k > 0){
+        int v = vs_select(ctx->heuristic, ctx->store.allocation, ctx->n_rcs, &ctx->stats, ctx->thr_in_dlock, ctx->n_thr);
+        /* Continuing the reduction with the instances released by the victim */
+        row_add(ctx->work, ctx->store.allocation[v], ctx->n_rcs);
+        ctx->finish[v] = true;
+        clear_thr(ctx, v);
+        if(victims != NULL)
+            victims[n] = v;
+        n += 1;
+        k = reduce(ctx, true);
+    }
+    ctx->victims += n;
+    pthread_mutex_unlock(&ctx->lock);
+    return (k < 0) ? k : n;
+}
+
+void dlock_counters(dlock_ctx *ctx, long *checks, long *deadlocks, long *victims){
+    pthread_mutex_lock(&ctx->lock);
+    if(checks != NULL)
+        *checks = ctx->checks;
+    if(deadlocks != NULL)
+        *deadlocks = ctx->deadlocks;
+    if(victims != NULL)
+        *victims = ctx->victims;
+    pthread_mutex_unlock(&ctx->lock);
+}
@@ -0,0 +1,117 @@
+#ifndef DLOCK_H
+#define DLOCK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Deadlock detection and resolution library.
+ * A detector is an opaque context created for one pool of resources: a fixed number of resource types with their
+ * instances, and up to a fixed number of threads. The application registers its threads, and reports what every thread
+ * waits for, what it is granted and what it releases; the detector then finds the threads in deadlock and chooses the
+ * ones to terminate with a heuristic. Contexts are independent of each other, and every call on a context is serialized
+ * by its own lock, so a context can be shared by the threads of its pool.
+ *
+ * Every function returning int returns a negative error code on failure.
+ */
+
+typedef struct dlock_ctx dlock_ctx;
+
+/* Heuristics choosing the thread of a deadlock to terminate */
+enum {
+    DLOCK_MAX_TOTAL = 1,    /* Maximum number of total instances allocated */
+    DLOCK_MAX_ANY,  /* Maximum instances of any resource type allocated */
+    DLOCK_MIN_TOTAL,    /* Minimum number of total instances allocated */
+    DLOCK_MIN_ANY,  /* Minimum instances of any resource type allocated */
+    DLOCK_LINEAR    /* First deadlocked thread */
+};
+
+/* Error codes */
+enum {
+    DLOCK_EINVAL = -1,  /* Invalid thread, resource type or count */
+    DLOCK_ENOMEM = -2,  /* Out of memory */
+    DLOCK_EFULL = -3,   /* Every thread slot is registered */
+    DLOCK_EAGAIN = -4   /* Not enough instances available for the grant */
+};
+
+/**
+ * Function to create a detector.
+ * @param max_threads Maximum number of threads registered at once
+ * @param n_rcs Number of resource types
+ * @param max_available Number of instances of every resource type
+ * @param heuristic One of DLOCK_MAX_TOTAL to DLOCK_LINEAR
+ * @return Return the detector, or NULL if the arguments are invalid or memory is short.
+ */
+dlock_ctx *dlock_create(int max_threads, int n_rcs, const int *max_available, int heuristic);
+
+/**
+ * Function to destroy a detector.
+ */
+void dlock_destroy(dlock_ctx *ctx);
+
+/**
+ * Function to register a thread, which holds and waits for nothing.
+ * @return Return the index of the thread in the detector.
+ */
+int dlock_register_thread(dlock_ctx *ctx);
+
+/**
+ * Function to unregister a thread, releasing everything it holds and cancelling what it waits for.
+ */
+int dlock_unregister_thread(dlock_ctx *ctx, int thr);
+
+/**
+ * Function to record that a thread waits for more instances of a resource type.
+ * @param n Number of instances added to what the thread waits for
+ */
+int dlock_request(dlock_ctx *ctx, int thr, int rcs, int n);
+
+/**
+ * Function to grant instances of a resource type to a thread. What the thread waits for is lowered by the grant.
+ * @return Return 0, or DLOCK_EAGAIN if fewer than n instances are available.
+ */
+int dlock_grant(dlock_ctx *ctx, int thr, int rcs, int n);
+
+/**
+ * Function to release instances of a resource type held by a thread.
+ */
+int dlock_release(dlock_ctx *ctx, int thr, int rcs, int n);
+
+/**
+ * Function to release every instance held by a thread, which then waits for nothing.
+ */
+int dlock_release_all(dlock_ctx *ctx, int thr);
+
+/**
+ * Function to get the number of available instances of a resource type.
+ */
+int dlock_available(dlock_ctx *ctx, int rcs);
+
+/**
+ * Function to find the threads in deadlock, without changing the state.
+ * @param thr_in_dlock Array of max_threads ints receiving the deadlocked threads, or NULL
+ * @return Return the number of threads in deadlock, 0 if there is none.
+ */
+int dlock_detect(dlock_ctx *ctx, int *thr_in_dlock);
+
+/**
+ * Function to resolve every deadlock. Victims are chosen one after the other with the heuristic, and terminated: the
+ * instances they hold are released and they wait for nothing. The application is expected to abort the work of the
+ * victims, which stay registered.
+ * @param victims Array of max_threads ints receiving the terminated threads, or NULL
+ * @return Return the number of threads terminated, 0 if there was no deadlock.
+ */
+int dlock_resolve(dlock_ctx *ctx, int *victims);
+
+/**
+ * Function to get the counters of a detector: calls of dlock_detect() and dlock_resolve(), deadlocks found and threads
+ * terminated. Any pointer may be NULL.
+ */
+void dlock_counters(dlock_ctx *ctx, long *checks, long *deadlocks, long *victims);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
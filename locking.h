@@ -0,0 +1,120 @@
+#ifndef LOCKING_H
+#define LOCKING_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/* Locking modes of the shared state */
+typedef enum {
+    LOCK_GLOBAL = 0,    /* Every access serialises on a single mutex */
+    LOCK_SHARDED = 1    /* One mutex per resource type and one per thread row */
+} lock_mode_t;
+
+/**
+ * Lock table of the shared state.
+ * In LOCK_SHARDED mode, rcs[ri] protects available_rcs[ri], the wait queue of ri and column ri of allocation, request
+ * and cur_request; row[t] protects the generation of the request set of thread t, which writes the whole row of
+ * request while the thread holds nothing. Locks are always taken in the order rcs[0..n_rcs-1], then row[0..n_thr-1],
+ * so lt_lock_all() gives a consistent cut of the whole state. In LOCK_GLOBAL mode every lock is the global mutex.
+ */
+typedef struct {
+    lock_mode_t mode;
+    pthread_mutex_t *global;
+    int n_rcs, n_thr;
+    pthread_mutex_t *rcs;
+    pthread_mutex_t *row;
+} lock_table;
+
+static inline bool lt_init(lock_table *lt, lock_mode_t mode, pthread_mutex_t *global, int n_rcs, int n_thr){
+    lt->mode = mode;
+    lt->global = global;
+    lt->n_rcs = n_rcs;
+    lt->n_thr = n_thr;
+    lt->rcs = NULL;
+    lt->row = NULL;
+    if(mode == LOCK_GLOBAL)
+        return true;
+    lt->rcs = (pthread_mutex_t *)malloc(sizeof(pthread_mutex_t) * (n_rcs > 0 ? n_rcs : 1));
+    lt->row = (pthread_mutex_t *)malloc(sizeof(pthread_mutex_t) * (n_thr > 0 ? n_thr : 1));
+    if(lt->rcs == NULL || lt->row == NULL){
+        free(lt->rcs);
+        free(lt->row);
+        return false;
+    }
+    for(int i = 0; i < n_rcs; i++){
+        pthread_mutex_init(&lt->rcs[i], NULL);
+    }
+    for(int i = 0; i < n_thr; i++){
+        pthread_mutex_init(&lt->row[i], NULL);
+    }
+    return true;
+}
+
+static inline void lt_destroy(lock_table *lt){
+    if(lt->mode == LOCK_SHARDED){
+        for(int i = 0; i < lt->n_rcs; i++){
+            pthread_mutex_destroy(&lt->rcs[i]);
+        }
+        for(int i = 0; i < lt->n_thr; i++){
+            pthread_mutex_destroy(&lt->row[i]);
+        }
+    }
+    free(lt->rcs);
+    free(lt->row);
+    lt->rcs = lt->row = NULL;
+}
+
+/**
+ * Function to get the mutex protecting resource type ri, which is also the mutex to wait with on the queue of ri.
+ */
+static pthread_mutex_t* lt_rcs(lock_table *lt, int ri){
+    return (lt->mode == LOCK_SHARDED) ? &lt->rcs[ri] : lt->global;
+}
+
+static void lt_lock_rcs(lock_table *lt, int ri){
+    pthread_mutex_lock(lt_rcs(lt, ri));
+}
+
+static void lt_unlock_rcs(lock_table *lt, int ri){
+    pthread_mutex_unlock(lt_rcs(lt, ri));
+}
+
+static void lt_lock_row(lock_table *lt, int t){
+    pthread_mutex_lock((lt->mode == LOCK_SHARDED) ? &lt->row[t] : lt->global);
+}
+
+static void lt_unlock_row(lock_table *lt, int t){
+    pthread_mutex_unlock((lt->mode == LOCK_SHARDED) ? &lt->row[t] : lt->global);
+}
+
+/**
+ * Function to lock the whole state, in the global lock order.
+ */
+static void lt_lock_all(lock_table *lt){
+    if(lt->mode == LOCK_GLOBAL){
+        pthread_mutex_lock(lt->global);
+        return;
+    }
+    for(int i = 0; i < lt->n_rcs; i++){
+        pthread_mutex_lock(&lt->rcs[i]);
+    }
+    for(int i = 0; i < lt->n_thr; i++){
+        pthread_mutex_lock(&lt->row[i]);
+    }
+}
+
+static void lt_unlock_all(lock_table *lt){
+    if(lt->mode == LOCK_GLOBAL){
+        pthread_mutex_unlock(lt->global);
+        return;
+    }
+    for(int i = lt->n_thr - 1; i >= 0; i--){
+        pthread_mutex_unlock(&lt->row[i]);
+    }
+    for(int i = lt->n_rcs - 1; i >= 0; i--){
+        pthread_mutex_unlock(&lt->rcs[i]);
+    }
+}
+
+#endif
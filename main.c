@@ -1,43 +1,181 @@
 #include "all_functions.h" 
 
+/**
+ * Function to print the usage of the program and exit.
+ * @param prog Name of the executable
+ */
+void usage(const char *prog){
+    printf("Usage: %s  [options]  max_num_threads  deadlock_detection_interval  heuristic_selected  total_simulation_time seed total_types_resources  resource_1_name  resource_1_max_instances  resource_2_name  resource_2_max_instances ....\n", prog);
+    printf("       %s  [options]  -S scenario_file\n", prog);
+    printf("where, \n");
+    printf("max_num_threads = The maximum number of threads to be used in the simulation\n");
+    printf("deadlock_detection_interval = The time interval in seconds between two successive deadlock detection checks\n");
+    printf("heuristic_selected = A number from 1 to 6 denoting one of the following heuristics to be adopted for resolving deadlocks\n");
+    printf("\t1. Terminate thread with maximum number of total resources allocated.\n");
+    printf("\t2. Terminate thread with maximum instances of any resource allocated.\n");
+    printf("\t3. Terminate thread with minimum number of total resources allocated.\n");
+    printf("\t4. Terminate thread with minimum instances of any resource allocated.\n");
+    printf("\t5. Terminate thread in a linear order of deadlocked threads.\n");
+    printf("total_simulation_time = The time(in seconds) after which the simulation should end\n");
+    printf("seed = The value of seed to be supplied to the random generator function\n");
+    printf("total_types_resources = The total number of types of resources\n");
+    printf("These arguments are followed by the resource names and their corresponding maximum available instances. Count of the resource types is determined by total_types_resources.\n");
+    printf("Options:\n");
+    printf("\t-r  Keep a resource-major copy of the request matrix for the column scans of the detector.\n");
+    printf("\t-s  Sharded locking: one lock per resource type and per thread row, and the detector works on a snapshot.\n");
+    printf("\t-o  Optimistic snapshots: the detector copies the state without locking it, validated by sequence counters.\n");
+    printf("\t-v level  Verbosity of the event log: 0 = off, 1 = detector only, 2 = every allocation and release (default).\n");
+    printf("\t-b file  Write the event log to file as binary records instead of text on the standard output.\n");
+    printf("\t-t count  Also check for deadlocks as soon as count threads are blocked.\n");
+    printf("\t-w sec  Also check for deadlocks as soon as a thread has been blocked for sec seconds.\n");
+    printf("\t-a  Adaptive interval: halved after a deadlock, doubled after a check without deadlock.\n");
+    printf("\t-p count  Split the deadlock detection across count threads when there are many threads.\n");
+    printf("\t-d  Discrete-event simulation: the threads are simulated in virtual time on a single core, deterministically for a seed.\n");
+    printf("\t-C seeds  Compare the heuristics: simulate every heuristic in virtual time on the same seeds, from seed on, and print a table. heuristic_selected is ignored.\n");
+    printf("\t-j jobs  Number of simulations run at once by -C (default: number of cores).\n");
+    printf("\t-m  Multi-victim resolution: choose every victim of a deadlock in one step instead of one per check.\n");
+    printf("\t-B  Deadlock avoidance: grant a request only if the state stays safe, with the Banker's algorithm.\n");
+    printf("\t-M prefix  Write the counters and histograms to prefix.json and prefix.prom during the run.\n");
+    printf("\t-i sec  Interval between two dumps of the metrics (default 1).\n");
+    printf("\t-T file  Record a binary trace of the state changes and of the detector to file, for replay.\n");
+    printf("\t-n threads  M:N mode: run the workers as tasks on a pool of threads (0 = number of cores) instead of one thread each.\n");
+    printf("\t-S file  Read the parameters, the resource types and the workload profiles from a scenario file, in text or binary form, instead of the command line.\n");
+    printf("\t-W profile  Workload profile of the threads when the scenario gives none: uniform (default), zipf, bursty, small, greedy or ordered.\n");
+    printf("\t-I  Incremental detection: only reduce the components of the state changed since the last check.\n");
+    printf("\t-z  Padding-only compaction: pad the rows of the matrices to 16 bytes instead of cache lines (saves memory below 16 resource types).\n");
+    printf("\t-P count  Minimum number of threads for the parallel detection (default %d).\n", PAR_DLOCK_THRESHOLD);
+    exit(-1);
+}
+
 int main(int argc, char *argv[]) {
-    if (argc <= 6) {
-        printf("Usage: %s  max_num_threads  deadlock_detection_interval  heuristic_selected  total_simulation_time seed total_types_resources  resource_1_name  resource_1_max_instances  resource_2_name  resource_2_max_instances ....\n",argv[0]);
-        printf("where, \n");
-        printf("max_num_threads = The maximum number of threads to be used in the simulation\n");
-        printf("deadlock_detection_interval = The time interval in seconds between two successive deadlock detection checks\n");
-        printf("heuristic_selected = A number from 1 to 6 denoting one of the following heuristics to be adopted for resolving deadlocks\n");
-        printf("\t1. Terminate thread with maximum number of total resources allocated.\n");
-        printf("\t2. Terminate thread with maximum instances of any resource allocated.\n");
-        printf("\t3. Terminate thread with minimum number of total resources allocated.\n");
-        printf("\t4. Terminate thread with minimum instances of any resource allocated.\n");
-        printf("\t5. Terminate thread in a linear order of deadlocked threads.\n");
-        printf("total_simulation_time = The time(in seconds) after which the simulation should end\n");
-        printf("seed = The value of seed to be supplied to the random generator function\n");
-        printf("total_types_resources = The total number of types of resources\n");
-        printf("These arguments are followed by the resource names and their corresponding maximum available instances. Count of the resource types is determined by total_types_resources.\n");
-        exit(-1);
+    bool rcs_major = false;
+    lock_mode_t lock_mode = LOCK_GLOBAL;
+    int log_level = EVLOG_ALL;
+    FILE *log_out = stdout;
+    bool log_binary = false;
+    int block_threshold = 0;
+    double block_time = 0;
+    bool adaptive = false;
+    int par_helpers = 0, par_threshold = PAR_DLOCK_THRESHOLD;
+    int compare_seeds = 0;
+    int jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const char *metrics_prefix = NULL;
+    double metrics_interval = 1;
+    const char *trace_path = NULL;
+    int pool_threads = 0;
+    const char *scenario_path = NULL;
+    bool incremental = false;
+    int opt;
+    /* Parsing the options preceding the positional arguments */
+    while ((opt = getopt(argc, argv, "+rsov:b:t:w:ap:P:dC:j:mBM:i:T:n:zS:W:I")) != -1) {
+        switch (opt) {
+            case 'r': rcs_major = true;
+                      break;
+            case 's': lock_mode = LOCK_SHARDED;
+                      break;
+            case 'o': snapshot_mode = SNAP_OPTIMISTIC;
+                      break;
+            case 'v': log_level = atoi(optarg);
+                      break;
+            case 'b': log_out = fopen(optarg, "wb");
+                      if (log_out == NULL) {
+                          log_msg("Failed to open the event log file.", true);
+                      }
+                      log_binary = true;
+                      break;
+            case 't': block_threshold = atoi(optarg);
+                      break;
+            case 'w': block_time = atof(optarg);
+                      break;
+            case 'a': adaptive = true;
+                      break;
+            case 'p': par_helpers = atoi(optarg);
+                      break;
+            case 'P': par_threshold = atoi(optarg);
+                      break;
+            case 'd': des_mode = true;
+                      break;
+            case 'C': compare_seeds = atoi(optarg);
+                      des_mode = true;
+                      break;
+            case 'j': jobs = atoi(optarg);
+                      break;
+            case 'm': multi_victim = true;
+                      break;
+            case 'B': avoidance = true;
+                      break;
+            case 'M': metrics_prefix = optarg;
+                      break;
+            case 'i': metrics_interval = atof(optarg);
+                      break;
+            case 'T': trace_path = optarg;
+                      break;
+            case 'n': task_mode = true;
+                      pool_threads = atoi(optarg);
+                      break;
+            case 'z': compact_state = true;
+                      break;
+            case 'S': scenario_path = optarg;
+                      break;
+            case 'I': incremental = true;
+                      break;
+            case 'W': default_profile = wl_find(optarg);
+                      if (default_profile < 0)
+                          usage(argv[0]);
+                      break;
+            default: usage(argv[0]);
+        }
+    }
+    if (des_mode || avoidance) {
+        /* A single thread drives the simulation, or every grant examines the whole state, so the detector simply
+        examines the live state */
+        lock_mode = LOCK_GLOBAL;
+        snapshot_mode = SNAP_LOCKED;
+    }
+    if (compare_seeds > 0) {
+        par_helpers = 0;    /* The helper threads would not survive the fork of the runs */
+        log_level = EVLOG_OFF;
+        metrics_prefix = NULL;  /* The runs would all write the same files */
+        trace_path = NULL;
+    }
+    if (des_mode) {
+        task_mode = false;  /* The virtual clock steps the workers itself */
     }
+    argv[optind - 1] = argv[0];
+    argv += optind - 1;
+    argc -= optind - 1;
+    if (scenario_path != NULL) {
+        if (argc > 1) {
+            usage(argv[0]);
+        }
+        char err[256];
+        if (!sc_load(&scen, scenario_path, err, sizeof(err))) {
+            log_msg(err, true);
+        }
+    } else if (argc <= 6 || !sc_from_args(&scen, argc - 1, argv + 1)) {
+        usage(argv[0]);
+    }
+    simd_init();    /* Selecting the row kernels for the CPU */
     pthread_mutex_init(&mutex, NULL);
-    pthread_cond_init(&cond, NULL);
-    max_threads = atoi(argv[1]);
-    d_check_interval = atoi(argv[2]);
-    heuristic_no = atoi(argv[3]);
-    exec_time = atoi(argv[4]);
-    seed = atoi(argv[5]);
-    total_types_rcs = atoi(argv[6]);
+    max_threads = scen.n_thr;
+    d_check_interval = scen.interval;
+    heuristic_no = scen.heuristic;
+    exec_time = scen.exec_time;
+    seed = scen.seed;
+    total_types_rcs = scen.n_rcs;
 
-    resources_name = (char**)malloc(total_types_rcs * sizeof(char*));
-    max_available_rcs = (int *) malloc(sizeof(int) * total_types_rcs);
-    available_rcs = (int *) malloc(sizeof(int) * total_types_rcs);
-    int len;
+    resources_name = scen.names;
+    max_available_rcs = scen.max_available;
+    available_rcs = (int *) malloc(sizeof(int) * (total_types_rcs > 0 ? total_types_rcs : 1));
+    memcpy(available_rcs, max_available_rcs, sizeof(int) * total_types_rcs);
+    /* With a single instance of every resource type, deadlocks are found as cycles of the wait-for graph */
+    wfg_mode = (total_types_rcs > 0);
     for(int i = 0; i < total_types_rcs; i++){
-        len = strlen(argv[7 + 2 * i]) + 1;
-        resources_name[i] = (char*)malloc(len * sizeof(char));
-        strcpy(resources_name[i], argv[7 + 2 * i]);
-        max_available_rcs[i] = atoi(argv[8 + 2 * i]);
-        available_rcs[i] = max_available_rcs[i];
+        if (max_available_rcs[i] != 1)
+            wfg_mode = false;
     }
+    if (avoidance)
+        wfg_mode = false;   /* No deadlock can form, and the safety check needs the matrices */
 
 
     printf("==========================Simulation==========================\n");
@@ -50,36 +188,112 @@ int main(int argc, char *argv[]) {
     printf("Deadlock detection interval = %d sec\n", d_check_interval);
     printf("Heuristic number = %d\n", heuristic_no);
     printf("Execution Time = %d sec\n", exec_time);
+    if (wfg_mode)
+        printf("Deadlock detection = wait-for graph\n");
+    if (avoidance)
+        printf("Deadlock avoidance = Banker's algorithm\n");
     printf("\n");
 
 
-    allocation = (int **)malloc(max_threads * sizeof(int *));
-    request = (int **)malloc(max_threads * sizeof(int *));
-    cur_request = (int **)malloc(max_threads * sizeof(int *));
+    /* The allocation, request and cur_request matrices are zero-initialised rows of one contiguous block */
+    if (!ss_init_ex(&store, max_threads, total_types_rcs, rcs_major, compact_state, true)) {
+        log_msg("Failed to allocate the state matrices.", true);
+    }
+    allocation = store.allocation;
+    request = store.request;
+    cur_request = store.cur_request;
+    if (!as_init(&astats, max_threads, total_types_rcs)) {
+        log_msg("Failed to allocate the allocation aggregates.", true);
+    }
+    ar_init(&det_arena);    // The temporaries of the detector take their first block on the first check
     thr_seeds = (int *)malloc(max_threads * sizeof(int));
+    set_start = (double *)calloc(max_threads, sizeof(double));
+    set_count = (int *)calloc(max_threads, sizeof(int));
+    set_done = (int *)calloc(max_threads, sizeof(int));
+    set_time = (double *)calloc(max_threads, sizeof(double));
+    set_lost = (double *)calloc(max_threads, sizeof(double));
+    if (!wl_init(total_types_rcs)) {
+        log_msg("Failed to set up the workload profiles.", true);
+    }
+    safety_work = (int *)malloc(sizeof(int) * total_types_rcs);
+    safety_finish = (bool *)malloc(sizeof(bool) * max_threads);
+    safety_left = (int *)malloc(sizeof(int) * max_threads);
+    wq_init(&unsafe_queue);
 
-    srand(seed);
+    if (!lt_init(&locks, lock_mode, &mutex, total_types_rcs, max_threads)) {
+        log_msg("Failed to allocate the locks.", true);
+    }
+    /* The sequence counters are only bumped by the writers when the optimistic copies or the partition read them */
+    bool use_seqs = (snapshot_mode == SNAP_OPTIMISTIC || (incremental && !wfg_mode));
+    if (use_seqs && !seq_init(&seqs, total_types_rcs, max_threads)) {
+        log_msg("Failed to allocate the sequence counters.", true);
+    }
+    /* The wait-for graph already examines only what changed */
+    if (incremental && !wfg_mode && !pt_init(&parts, max_threads, total_types_rcs)) {
+        log_msg("Failed to allocate the components of the state.", true);
+    }
+    if (!evlog_init(&evlog, max_threads + 1, 1024, 2 * max_threads + 64, log_level, log_out, log_binary) ||
+        (!des_mode && !evlog_start(&evlog))) {
+        log_msg("Failed to start the event log.", true);
+    }
+    if (!trig_init(&trigger, max_threads, d_check_interval, block_threshold, block_time, adaptive)) {
+        log_msg("Failed to set up the detection trigger.", true);
+    }
+    if (wfg_mode && !wfg_init(&wfg, max_threads, total_types_rcs)) {
+        log_msg("Failed to allocate the wait-for graph.", true);
+    }
+    if (metrics_prefix != NULL && (!mt_init(&run_metrics, max_threads + 1, metrics_prefix, metrics_interval, sim_now) ||
+                                   (!des_mode && !mt_start_dumper(&run_metrics)))) {
+        log_msg("Failed to set up the metrics.", true);
+    }
+    if (trace_path != NULL) {
+        trace_start = sim_now();
+        if (!tr_open(&trace, trace_path, TRACE_CAPACITY, max_threads, total_types_rcs, heuristic_no, max_available_rcs)) {
+            log_msg("Failed to create the trace file.", true);
+        }
+    }
+    if (!par_init(&dpool, par_helpers, par_threshold, total_types_rcs)) {
+        log_msg("Failed to start the helper threads of the deadlock detection.", true);
+    }
+    rcs_queues = (wait_queue *)malloc(sizeof(wait_queue) * total_types_rcs);
+    waiters = (wq_waiter *)malloc(sizeof(wq_waiter) * max_threads);
+    for (int i = 0; i < total_types_rcs; i++){
+        wq_init(&rcs_queues[i]);
+    }
     for (int i = 0; i < max_threads; i++){
-        allocation[i] = (int*)malloc(total_types_rcs * sizeof(int));
-        request[i] = (int*)malloc(total_types_rcs * sizeof(int));
-        cur_request[i] = (int*)malloc(total_types_rcs * sizeof(int));
-        thr_seeds[i] = rand();
+        wq_waiter_init(&waiters[i], i);
     }
 
-    for(int i = 0; i < max_threads; i++){
-        for(int j = 0; j < total_types_rcs; j++){
-            allocation[i][j] = 0;
-            request[i][j] = 0;
-            cur_request[i][j] = 0;
-        }
+    srand(seed);
+    for (int i = 0; i < max_threads; i++){
+        thr_seeds[i] = rand();
     }
     
+    if (compare_seeds > 0) {
+        compare_heuristics(compare_seeds, (jobs > 0) ? jobs : 1);
+        return 0;
+    }
+    if (des_mode) {
+        /* Simulating exec_time seconds of virtual time, then reporting as when the time allowed expires */
+        des_run(exec_time);
+        sig_handler(SIGALRM);
+    }
+
     signal(SIGALRM, sig_handler); // Register signal handler for SIGALRM
     signal(SIGINT,sig_handler); // Register signal handler for SIGINT
     alarm(exec_time);
 
-    createAllThreads();
+    if (task_mode) {
+        createAllTasks((pool_threads > 0) ? pool_threads : (int)sysconf(_SC_NPROCESSORS_ONLN));
+    } else {
+        createAllThreads();
+    }
+    par_destroy(&dpool);    // Stopping the helper threads of the deadlock detection
+    trig_destroy(&trigger);    // Destroying the trigger, which the detector waits on
+    lt_destroy(&locks);    // Destroying the per resource and per row locks
     pthread_mutex_destroy(&mutex);  // Destroying the mutex
-    pthread_cond_destroy(&cond);    // Destroying the conditional variable
+    for (int i = 0; i < max_threads; i++){
+        wq_waiter_destroy(&waiters[i]);    // Destroying the condition variables of the waiters
+    }
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,336 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Counters and latency histograms of the simulation.
+ * Every thread records into its own slot (worker i into slot i, the detector into the last one), with plain relaxed
+ * stores since a slot has a single writer, so recording takes no lock and shares no cache line. The histograms are
+ * log-linear, in the manner of HDR histograms: four sub-buckets per power of two, so every recorded value is kept within
+ * 25% over the whole range of 64-bit values, in 252 buckets. A dump merges the slots and writes a JSON file and a
+ * Prometheus text file, each replaced atomically, periodically by a dumper thread and once more at the end of the run.
+ * Recording is skipped entirely, clock reads included, when the metrics are disabled.
+ */
+
+/* Counters */
+enum {
+    MT_GRANTS,  /* Allocations of instances */
+    MT_RELEASES,    /* Releases of a resource type */
+    MT_CHECKS,  /* Deadlock checks */
+    MT_DLOCKS,  /* Deadlocks found */
+    MT_VICTIMS, /* Threads terminated */
+    MT_COUNTERS
+};
+
+/* Histograms */
+enum {
+    MH_LOCK_HOLD,   /* Time a lock of the state is held, in ns */
+    MH_COND_WAIT,   /* Time blocked on a resource queue, in ns */
+    MH_CHECK,   /* Duration of a deadlock check, in ns */
+    MH_RESOLVE, /* Duration of the resolution of a deadlock, in ns */
+    MH_VICTIMS, /* Threads terminated per deadlock */
+    MH_SET, /* Time from the generation of a request set to its release, in ns */
+    MT_HISTS
+};
+
+#define MT_SUB_BITS 2
+#define MT_SUB (1 << MT_SUB_BITS)
+#define MT_BUCKETS (MT_SUB + (64 - MT_SUB_BITS) * MT_SUB)
+
+typedef struct {
+    uint64_t counters[MT_COUNTERS];
+    uint64_t sum[MT_HISTS];
+    uint64_t max[MT_HISTS];
+    uint64_t hist[MT_HISTS][MT_BUCKETS];
+} __attribute__((aligned(64))) mt_slot;
+
+typedef struct {
+    bool enabled;
+    int n_slots;
+    mt_slot *slots;
+    double (*now)(void);    /* Time base of the rates, in seconds */
+    double start, last; /* Time of the set-up and of the last dump */
+    uint64_t last_counters[MT_COUNTERS];
+    char *json_path, *prom_path;
+    double interval;    /* Time between two dumps, in seconds */
+    bool running;
+    pthread_t dumper;
+    pthread_mutex_t dump_lock;  /* Serialises the dumps */
+} metrics;
+
+static const char *mt_counter_names[MT_COUNTERS] = {"grants", "releases", "checks", "deadlocks", "victims"};
+static const char *mt_hist_names[MT_HISTS] = {"lock_hold", "cond_wait", "check", "resolve", "victims_per_deadlock",
+                                                "request_set"};
+static const bool mt_hist_is_time[MT_HISTS] = {true, true, true, true, false, true};
+
+static uint64_t mt_now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Function to set up the metrics.
+ * @param n_slots Number of recording threads
+ * @param prefix Files written are prefix.json and prefix.prom
+ * @param interval Time between two dumps, in seconds
+ * @param now Clock of the simulation, used for the rates
+ * @return Return true on success.
+ */
+static inline bool mt_init(metrics *m, int n_slots, const char *prefix, double interval, double (*now)(void)){
+    memset(m, 0, sizeof(*m));
+    pthread_mutex_init(&m->dump_lock, NULL);
+    m->n_slots = n_slots;
+    m->interval = (interval > 0) ? interval : 1;
+    m->now = now;
+    m->slots = (mt_slot *)aligned_alloc(64, sizeof(mt_slot) * n_slots);
+    m->json_path = (char *)malloc(strlen(prefix) + 6);
+    m->prom_path = (char *)malloc(strlen(prefix) + 6);
+    if(m->slots == NULL || m->json_path == NULL || m->prom_path == NULL)
+        return false;
+    memset(m->slots, 0, sizeof(mt_slot) * n_slots);
+    sprintf(m->json_path, "%s.json", prefix);
+    sprintf(m->prom_path, "%s.prom", prefix);
+    m->start = m->last = now();
+    m->enabled = true;
+    return true;
+}
+
+static int mt_bucket(uint64_t v){
+    if(v < MT_SUB)
+        return (int)v;
+    int e = 63 - __builtin_clzll(v);
+    int sub = (int)(v >> (e - MT_SUB_BITS)) & (MT_SUB - 1);
+    return MT_SUB + (e - MT_SUB_BITS) * MT_SUB + sub;
+}
+
+/**
+ * Function to get the largest value recorded in a bucket.
+ */
+static uint64_t mt_bucket_high(int b){
+    if(b < MT_SUB)
+        return (uint64_t)b;
+    int e = (b - MT_SUB) / MT_SUB + MT_SUB_BITS;
+    uint64_t low = (uint64_t)(MT_SUB + (b - MT_SUB) % MT_SUB) << (e - MT_SUB_BITS);
+    return low + ((1ull << (e - MT_SUB_BITS)) - 1);
+}
+
+static void mt_add(uint64_t *x, uint64_t n){
+    __atomic_store_n(x, __atomic_load_n(x, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+}
+
+/**
+ * Function to record a value into a histogram of a slot.
+ */
+static void mt_value(metrics *m, int slot, int h, uint64_t v){
+    if(!m->enabled)
+        return;
+    mt_slot *s = &m->slots[slot];
+    mt_add(&s->hist[h][mt_bucket(v)], 1);
+    mt_add(&s->sum[h], v);
+    if(v > __atomic_load_n(&s->max[h], __ATOMIC_RELAXED))
+        __atomic_store_n(&s->max[h], v, __ATOMIC_RELAXED);
+}
+
+/**
+ * Function to add to a counter of a slot.
+ */
+static void mt_count(metrics *m, int slot, int c, uint64_t n){
+    if(m->enabled)
+        mt_add(&m->slots[slot].counters[c], n);
+}
+
+/**
+ * Function to start timing an interval.
+ * @return Return the current time in ns, 0 if the metrics are disabled.
+ */
+static uint64_t mt_start(const metrics *m){
+    return m->enabled ? mt_now_ns() : 0;
+}
+
+/**
+ * Function to record the time elapsed since mt_start() into a histogram of a slot.
+ */
+static void mt_record(metrics *m, int slot, int h, uint64_t t0){
+    if(t0 != 0)
+        mt_value(m, slot, h, mt_now_ns() - t0);
+}
+
+/* Merged histogram */
+typedef struct {
+    uint64_t count, sum, max;
+    uint64_t hist[MT_BUCKETS];
+} mt_merged;
+
+static void mt_merge(metrics *m, int h, mt_merged *out){
+    memset(out, 0, sizeof(*out));
+    for(int i = 0; i < m->n_slots; i++){
+        mt_slot *s = &m->slots[i];
+        for(int b = 0; b < MT_BUCKETS; b++){
+            uint64_t n = __atomic_load_n(&s->hist[h][b], __ATOMIC_RELAXED);
+            out->hist[b] += n;
+            out->count += n;
+        }
+        out->sum += __atomic_load_n(&s->sum[h], __ATOMIC_RELAXED);
+        uint64_t mx = __atomic_load_n(&s->max[h], __ATOMIC_RELAXED);
+        if(mx > out->max)
+            out->max = mx;
+    }
+}
+
+/**
+ * Function to get a quantile of a merged histogram, as the upper bound of its bucket.
+ */
+static uint64_t mt_quantile(const mt_merged *mh, double q){
+    if(mh->count == 0)
+        return 0;
+    uint64_t rank = (uint64_t)(q * (mh->count - 1)) + 1, seen = 0;
+    for(int b = 0; b < MT_BUCKETS; b++){
+        seen += mh->hist[b];
+        if(seen >= rank){
+            uint64_t v = mt_bucket_high(b);
+            return (v < mh->max) ? v : mh->max;
+        }
+    }
+    return mh->max;
+}
+
+static const double mt_quantiles[] = {0.5, 0.9, 0.99, 0.999};
+#define MT_N_QUANTILES 4
+
+/**
+ * Function to write a file through a temporary one, so that readers never see it half written.
+ */
+static FILE *mt_open_tmp(const char *path, char *tmp){
+    sprintf(tmp, "%s.tmp", path);
+    return fopen(tmp, "w");
+}
+
+static void mt_commit_tmp(FILE *f, const char *path, const char *tmp){
+    fclose(f);
+    rename(tmp, path);
+}
+
+/**
+ * Function to dump the metrics: the counters, their rates since the last dump and over the whole run, and the count,
+ * sum, maximum and quantiles of every histogram.
+ */
+static void mt_dump(metrics *m){
+    if(!m->enabled)
+        return;
+    pthread_mutex_lock(&m->dump_lock);
+    double now = m->now();
+    double dt = now - m->last, elapsed = now - m->start;
+    uint64_t counters[MT_COUNTERS] = {0};
+    for(int i = 0; i < m->n_slots; i++){
+        for(int c = 0; c < MT_COUNTERS; c++){
+            counters[c] += __atomic_load_n(&m->slots[i].counters[c], __ATOMIC_RELAXED);
+        }
+    }
+    mt_merged *merged = (mt_merged *)malloc(sizeof(mt_merged) * MT_HISTS);
+    if(merged == NULL){
+        pthread_mutex_unlock(&m->dump_lock);
+        return;
+    }
+    for(int h = 0; h < MT_HISTS; h++){
+        mt_merge(m, h, &merged[h]);
+    }
+    char tmp[strlen(m->json_path) + strlen(m->prom_path) + 8];
+
+    FILE *f = mt_open_tmp(m->json_path, tmp);
+    if(f != NULL){
+        fprintf(f, "{\"time\":%.6f,\"elapsed\":%.6f,\"counters\":{", now, elapsed);
+        for(int c = 0; c < MT_COUNTERS; c++){
+            fprintf(f, "%s\"%s\":%llu", c ? "," : "", mt_counter_names[c], (unsigned long long)counters[c]);
+        }
+        fprintf(f, "},\"rates\":{");
+        for(int c = 0; c < MT_COUNTERS; c++){
+            double recent = (dt > 0) ? (counters[c] - m->last_counters[c]) / dt : 0;
+            double overall = (elapsed > 0) ? counters[c] / elapsed : 0;
+            fprintf(f, "%s\"%s_per_sec\":%.3f,\"%s_per_sec_overall\":%.3f", c ? "," : "", mt_counter_names[c], recent,
+                    mt_counter_names[c], overall);
+        }
+        fprintf(f, "},\"histograms\":{");
+        for(int h = 0; h < MT_HISTS; h++){
+            mt_merged *mh = &merged[h];
+            fprintf(f, "%s\"%s%s\":{\"count\":%llu,\"sum\":%llu,\"mean\":%.1f,\"max\":%llu", h ? "," : "",
+                    mt_hist_names[h], mt_hist_is_time[h] ? "_ns" : "", (unsigned long long)mh->count,
+                    (unsigned long long)mh->sum, mh->count ? (double)mh->sum / mh->count : 0,
+                    (unsigned long long)mh->max);
+            for(int q = 0; q < MT_N_QUANTILES; q++){
+                fprintf(f, ",\"p%g\":%llu", mt_quantiles[q] * 100, (unsigned long long)mt_quantile(mh, mt_quantiles[q]));
+            }
+            fprintf(f, "}");
+        }
+        fprintf(f, "}}\n");
+        mt_commit_tmp(f, m->json_path, tmp);
+    }
+
+    f = mt_open_tmp(m->prom_path, tmp);
+    if(f != NULL){
+        for(int c = 0; c < MT_COUNTERS; c++){
+            fprintf(f, "# TYPE dlock_%s_total counter\ndlock_%s_total %llu\n", mt_counter_names[c], mt_counter_names[c],
+                    (unsigned long long)counters[c]);
+            fprintf(f, "# TYPE dlock_%s_per_second gauge\ndlock_%s_per_second %.3f\n", mt_counter_names[c],
+                    mt_counter_names[c], (dt > 0) ? (counters[c] - m->last_counters[c]) / dt : 0);
+        }
+        for(int h = 0; h < MT_HISTS; h++){
+            mt_merged *mh = &merged[h];
+            double scale = mt_hist_is_time[h] ? 1e-9 : 1;   /* Times are exported in seconds */
+            const char *unit = mt_hist_is_time[h] ? "_seconds" : "";
+            fprintf(f, "# TYPE dlock_%s%s summary\n", mt_hist_names[h], unit);
+            for(int q = 0; q < MT_N_QUANTILES; q++){
+                fprintf(f, "dlock_%s%s{quantile=\"%g\"} %.9g\n", mt_hist_names[h], unit, mt_quantiles[q],
+                        mt_quantile(mh, mt_quantiles[q]) * scale);
+            }
+            fprintf(f, "dlock_%s%s_sum %.9g\ndlock_%s%s_count %llu\n", mt_hist_names[h], unit, mh->sum * scale,
+                    mt_hist_names[h], unit, (unsigned long long)mh->count);
+        }
+        mt_commit_tmp(f, m->prom_path, tmp);
+    }
+    free(merged);
+    memcpy(m->last_counters, counters, sizeof(counters));
+    m->last = now;
+    pthread_mutex_unlock(&m->dump_lock);
+}
+
+/* Dumper thread, which blocks the termination signals so that they are handled by the main thread */
+static void *mt_dumper(void *arg){
+    metrics *m = (metrics *)arg;
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGALRM);
+    sigaddset(&set, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+    struct timespec t;
+    t.tv_sec = (time_t)m->interval;
+    t.tv_nsec = (long)((m->interval - t.tv_sec) * 1e9);
+    while(__atomic_load_n(&m->running, __ATOMIC_ACQUIRE)){
+        nanosleep(&t, NULL);
+        mt_dump(m);
+    }
+    return NULL;
+}
+
+/**
+ * Function to start dumping the metrics periodically.
+ * @return Return true if the dumper thread was started.
+ */
+static inline bool mt_start_dumper(metrics *m){
+    __atomic_store_n(&m->running, true, __ATOMIC_RELEASE);
+    if(pthread_create(&m->dumper, NULL, mt_dumper, m) != 0){
+        m->running = false;
+        return false;
+    }
+    return true;
+}
+
+#endif
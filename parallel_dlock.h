@@ -0,0 +1,187 @@
+#ifndef PARALLEL_DLOCK_H
+#define PARALLEL_DLOCK_H
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "simd_kernels.h"
+
+#define PAR_DLOCK_THRESHOLD 4096    /* Default number of threads below which the serial worklist engine is used */
+
+/**
+ * Pool of helper threads for the deadlock detection of very large states.
+ * The rows are split into one slice per helper, the caller working on slice 0. In every round, each helper scans the
+ * unfinished threads of its slice once, finishing those whose request fits in its private copy of work and adding their
+ * allocation to that copy, so chains of threads within a slice finish in one round. The caller then merges the growth
+ * of every private copy into work. Rounds stop when one finishes no thread. Reduction is monotone, so the threads left
+ * unfinished are exactly those left by the serial reduction.
+ * The pool serves one caller at a time.
+ */
+typedef struct {
+    int n_helpers;  /* Number of slices, including the one of the caller */
+    int threshold;  /* Minimum number of threads for the parallel path */
+    pthread_t *helpers;
+    pthread_barrier_t start, done;
+    bool stop;
+
+    /* Job of the current round */
+    int n_thr, n_rcs, ld;
+    int **alloc, **req;
+    const int *work;
+    bool *finish;
+    int *local_work;    /* Private copy of work of every helper, ld entries each */
+    int *finished;  /* Number of threads finished by every helper in the round */
+    int *base;  /* Scratch: work before the merge of a round, ld entries */
+} par_pool;
+
+/**
+ * Function to run one round on the slice of helper h.
+ */
+static void par_round(par_pool *pp, int h){
+    int lo = (int)((long)pp->n_thr * h / pp->n_helpers);
+    int hi = (int)((long)pp->n_thr * (h + 1) / pp->n_helpers);
+    int *w = pp->local_work + (size_t)h * pp->ld;
+    memcpy(w, pp->work, sizeof(int) * pp->n_rcs);
+    int count = 0;
+    for(int i = lo; i < hi; i++){
+        if(!pp->finish[i] && row_le(pp->req[i], w, pp->n_rcs)){
+            pp->finish[i] = true;
+            row_add(w, pp->alloc[i], pp->n_rcs);
+            count += 1;
+        }
+    }
+    pp->finished[h] = count;
+}
+
+typedef struct {
+    par_pool *pp;
+    int h;
+} par_helper_arg;
+
+static void* par_helper(void *arg){
+    par_helper_arg a = *(par_helper_arg *)arg;
+    free(arg);
+    /* The signal handlers take the locks held by the caller while it waits for the helpers */
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGALRM);
+    sigaddset(&set, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+    while(true){
+        pthread_barrier_wait(&a.pp->start);
+        if(a.pp->stop)
+            break;
+        par_round(a.pp, a.h);
+        pthread_barrier_wait(&a.pp->done);
+    }
+    return NULL;
+}
+
+/**
+ * Function to start the helper threads.
+ * @param n_helpers Number of slices, including the caller's; values below 2 leave the pool disabled
+ * @param threshold Minimum number of threads for the parallel path
+ * @param n_rcs Number of resource types
+ * @return Return true on success.
+ */
+static inline bool par_init(par_pool *pp, int n_helpers, int threshold, int n_rcs){
+    memset(pp, 0, sizeof(*pp));
+    pp->threshold = threshold;
+    if(n_helpers < 2)
+        return true;
+    pp->ld = ((n_rcs + 15) / 16) * 16;  /* Keeping the private copies a cache line apart */
+    if(pp->ld == 0)
+        pp->ld = 16;
+    pp->helpers = (pthread_t *)malloc(sizeof(pthread_t) * n_helpers);
+    pp->local_work = (int *)malloc(sizeof(int) * pp->ld * n_helpers);
+    pp->finished = (int *)malloc(sizeof(int) * n_helpers);
+    pp->base = (int *)malloc(sizeof(int) * pp->ld);
+    if(pp->helpers == NULL || pp->local_work == NULL || pp->finished == NULL || pp->base == NULL)
+        return false;
+    pthread_barrier_init(&pp->start, NULL, n_helpers);
+    pthread_barrier_init(&pp->done, NULL, n_helpers);
+    pp->n_helpers = n_helpers;
+    for(int h = 1; h < n_helpers; h++){
+        par_helper_arg *a = (par_helper_arg *)malloc(sizeof(par_helper_arg));
+        if(a == NULL)
+            return false;
+        a->pp = pp;
+        a->h = h;
+        if(pthread_create(&pp->helpers[h], NULL, par_helper, a) != 0)
+            return false;
+    }
+    return true;
+}
+
+static inline void par_destroy(par_pool *pp){
+    if(pp->n_helpers >= 2){
+        pp->stop = true;
+        pthread_barrier_wait(&pp->start);
+        for(int h = 1; h < pp->n_helpers; h++){
+            pthread_join(pp->helpers[h], NULL);
+        }
+        pthread_barrier_destroy(&pp->start);
+        pthread_barrier_destroy(&pp->done);
+    }
+    free(pp->helpers);
+    free(pp->local_work);
+    free(pp->finished);
+    free(pp->base);
+    memset(pp, 0, sizeof(*pp));
+}
+
+/**
+ * Function to check whether the parallel path should be used for a state of n_thr threads.
+ */
+static bool par_enabled(const par_pool *pp, int n_thr){
+    return pp->n_helpers >= 2 && n_thr >= pp->threshold;
+}
+
+/**
+ * Parallel reduction of the resource allocation state, with the same contract as worklist_reduce().
+ * @param work Available instances on entry, instances held by unfinished threads added on return
+ * @param finish On entry, true for threads already known to be finished
+ * @return Return the number of threads left unfinished.
+ */
+static int par_reduce(par_pool *pp, int n_thr, int n_rcs, int **alloc, int **req, int work[], bool finish[]){
+    pp->n_thr = n_thr;
+    pp->n_rcs = n_rcs;
+    pp->alloc = alloc;
+    pp->req = req;
+    pp->work = work;
+    pp->finish = finish;
+    while(true){
+        pthread_barrier_wait(&pp->start);
+        par_round(pp, 0);
+        pthread_barrier_wait(&pp->done);
+
+        /* Merging the growth of every private copy of work */
+        int progress = 0;
+        for(int h = 0; h < pp->n_helpers; h++){
+            progress += pp->finished[h];
+        }
+        if(progress == 0)
+            break;
+        int *base = pp->base;
+        memcpy(base, work, sizeof(int) * n_rcs);
+        for(int h = 0; h < pp->n_helpers; h++){
+            if(pp->finished[h] == 0)
+                continue;
+            const int *w = pp->local_work + (size_t)h * pp->ld;
+            for(int j = 0; j < n_rcs; j++){
+                work[j] += w[j] - base[j];
+            }
+        }
+    }
+    int unfinished = 0;
+    for(int i = 0; i < n_thr; i++){
+        if(!finish[i])
+            unfinished += 1;
+    }
+    return unfinished;
+}
+
+#endif
@@ -0,0 +1,181 @@
+#ifndef PARTITION_H
+#define PARTITION_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "simd_kernels.h"
+
+/*
+ * Partition of the state into connected components, for incremental deadlock detection.
+ * The nodes are the threads(0 to n_thr - 1) and the resource types(n_thr to n_thr + n_rcs - 1), and a thread is linked
+ * to every resource type it holds or requests. Whether a thread can finish only depends on the threads and resource
+ * types of its component, so a component whose rows and columns did not change since the last pass keeps its verdict:
+ * after a pass every deadlock was resolved, so its threads all finish, and they need not be reduced again.
+ *
+ * Changes are found with the sequence counters of the rows and columns of the state(snapshot.h), observed when the
+ * state is taken. A component of the last pass is stale when one of its nodes changed, or one of its threads was left
+ * in deadlock; the threads of stale components and the changed threads are scanned again, and every other node keeps
+ * the component it had, which is still a component of the state since none of its rows or columns changed. A new
+ * component is reduced if it holds a scanned or changed node, which covers both components that merged into a stale
+ * one and components split from one.
+ */
+typedef struct {
+    int n_thr, n_rcs;
+    bool first;     /* No pass yet: every node is scanned */
+    unsigned int *seen; /* Counters observed by the last pass: columns, then rows */
+    unsigned int *now;  /* Counters observed by the current pass */
+    int *label;     /* Component of every node at the last pass, the index of its root */
+    int *parent;    /* Union-find forest of the current pass */
+    int *rep;       /* Scratch: first node of every label */
+    bool *stale;    /* Scratch: per label of the last pass, per root of the current pass */
+    bool *scan;     /* Scratch: nodes scanned again by the current pass */
+    bool *was_dlocked;  /* Threads left unfinished by the last pass */
+
+    long reduced;   /* Threads put through the reduction */
+    long skipped;   /* Threads of unchanged components, given their last verdict */
+} partition;
+
+static inline bool pt_init(partition *pt, int n_thr, int n_rcs){
+    memset(pt, 0, sizeof(*pt));
+    pt->n_thr = n_thr;
+    pt->n_rcs = n_rcs;
+    pt->first = true;
+    int n = n_thr + n_rcs;
+    pt->seen = (unsigned int *)calloc(n + 1, sizeof(unsigned int));
+    pt->now = (unsigned int *)calloc(n + 1, sizeof(unsigned int));
+    pt->label = (int *)malloc(sizeof(int) * (n + 1));
+    pt->parent = (int *)malloc(sizeof(int) * (n + 1));
+    pt->rep = (int *)malloc(sizeof(int) * (n + 1));
+    pt->stale = (bool *)calloc(n + 1, sizeof(bool));
+    pt->scan = (bool *)calloc(n + 1, sizeof(bool));
+    pt->was_dlocked = (bool *)calloc(n_thr + 1, sizeof(bool));
+    return pt->seen != NULL && pt->now != NULL && pt->label != NULL && pt->parent != NULL && pt->rep != NULL &&
+           pt->stale != NULL && pt->scan != NULL && pt->was_dlocked != NULL;
+}
+
+static void pt_destroy(partition *pt){
+    free(pt->seen);
+    free(pt->now);
+    free(pt->label);
+    free(pt->parent);
+    free(pt->rep);
+    free(pt->stale);
+    free(pt->scan);
+    free(pt->was_dlocked);
+    memset(pt, 0, sizeof(*pt));
+}
+
+static bool pt_enabled(const partition *pt){
+    return pt->seen != NULL;
+}
+
+/**
+ * Function to record the counters of the state being taken. Must be called while they describe the state examined:
+ * under the locks of the whole state, or with the counters validating an optimistic copy.
+ * @param counters Counters of the columns, followed by the counters of the rows
+ */
+static void pt_observe(partition *pt, const unsigned int *counters){
+    for(int k = 0; k < pt->n_rcs + pt->n_thr; k++){
+        pt->now[k] = __atomic_load_n(&counters[k], __ATOMIC_RELAXED);
+    }
+}
+
+static int pt_find(int *parent, int x){
+    while(parent[x] != x){
+        parent[x] = parent[parent[x]];
+        x = parent[x];
+    }
+    return x;
+}
+
+static void pt_union(int *parent, int a, int b){
+    a = pt_find(parent, a);
+    b = pt_find(parent, b);
+    if(a != b){
+        /* The smaller index stays the root, so that labels do not depend on the order of the unions */
+        if(a < b)
+            parent[b] = a;
+        else
+            parent[a] = b;
+    }
+}
+
+/**
+ * Function to update the components from the observed counters, and mark as finished the threads of the components
+ * that keep their verdict. The other threads are marked finished if they hold nothing, as for a full reduction.
+ * @param alloc, req Rows of the state examined
+ * @param finish Set for every thread
+ */
+static void pt_plan(partition *pt, int **alloc, int **req, bool finish[]){
+    int n_thr = pt->n_thr, n_rcs = pt->n_rcs, n = n_thr + n_rcs;
+    /* Nodes whose row or column changed, and the components of the last pass holding one */
+    for(int x = 0; x < n; x++){
+        pt->stale[x] = false;
+        pt->rep[x] = -1;
+    }
+    for(int x = 0; x < n; x++){
+        bool changed;
+        if(x < n_thr)
+            changed = pt->now[n_rcs + x] != pt->seen[n_rcs + x] || pt->was_dlocked[x];
+        else
+            changed = pt->now[x - n_thr] != pt->seen[x - n_thr];
+        pt->scan[x] = pt->first || changed;
+        if(pt->scan[x] && !pt->first)
+            pt->stale[pt->label[x]] = true;
+    }
+    /* Every node of a stale component is scanned again; the others are joined to the first node of their component */
+    for(int x = 0; x < n; x++){
+        if(!pt->first && pt->stale[pt->label[x]])
+            pt->scan[x] = true;
+        if(pt->scan[x]){
+            pt->parent[x] = x;
+        }else{
+            int l = pt->label[x];
+            if(pt->rep[l] < 0)
+                pt->rep[l] = x;
+            pt->parent[x] = pt->rep[l];
+        }
+    }
+    for(int t = 0; t < n_thr; t++){
+        if(!pt->scan[t])
+            continue;
+        for(int j = 0; j < n_rcs; j++){
+            if(alloc[t][j] != 0 || req[t][j] != 0)
+                pt_union(pt->parent, t, n_thr + j);
+        }
+    }
+    /* The new components holding a scanned node are reduced */
+    for(int x = 0; x < n; x++){
+        pt->label[x] = pt_find(pt->parent, x);
+        pt->stale[x] = false;
+    }
+    for(int x = 0; x < n; x++){
+        if(pt->scan[x])
+            pt->stale[pt->label[x]] = true;
+    }
+    for(int t = 0; t < n_thr; t++){
+        if(pt->stale[pt->label[t]]){
+            finish[t] = (row_max(alloc[t], n_rcs) <= 0);   /* Threads holding nothing are finished */
+            pt->reduced += 1;
+        }else{
+            finish[t] = true;
+            pt->skipped += 1;
+        }
+    }
+    pt->first = false;
+}
+
+/**
+ * Function to end a pass, keeping the observed counters and the threads left in deadlock.
+ * @param finish Threads finished by the reduction and the resolution
+ */
+static void pt_commit(partition *pt, const bool finish[]){
+    memcpy(pt->seen, pt->now, sizeof(unsigned int) * (pt->n_rcs + pt->n_thr));
+    for(int t = 0; t < pt->n_thr; t++){
+        pt->was_dlocked[t] = !finish[t];
+    }
+}
+
+#endif
@@ -0,0 +1,370 @@
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "workload.h"
+
+/*
+ * Scenario of a simulation: the parameters otherwise given on the command line, the table of resource types, and the
+ * workload profile of every thread. A scenario is read from a text file, or memory-mapped from its binary form.
+ *
+ * Text form, one directive per line, '#' starting a comment:
+ *   threads <n>
+ *   interval <sec>
+ *   heuristic <n>
+ *   time <sec>
+ *   seed <n>
+ *   resource <name> <instances>        (once per resource type, in order)
+ *   profile <name> [<first> [<last>]]  (every thread, or threads first to last; after threads)
+ * The whole file is read into one buffer and the names point into it, so there is one allocation per table rather than
+ * one per resource type.
+ *
+ * Binary form: a header, followed by the instances of every resource type (int32), the offset of every name in the
+ * string pool (uint32), the string pool of NUL-terminated names, and the profile of every thread (uint8). The file is
+ * mapped privately and the tables are used in place; only the array of name pointers is built.
+ */
+
+#define SC_MAGIC 0x43534c44u    /* "DLSC" */
+#define SC_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    int32_t n_thr;
+    int32_t interval;
+    int32_t heuristic;
+    int32_t exec_time;
+    uint32_t seed;
+    int32_t n_rcs;
+    uint64_t counts_off;    /* int32[n_rcs] */
+    uint64_t names_off; /* uint32[n_rcs], offsets in the string pool */
+    uint64_t pool_off;
+    uint64_t pool_len;
+    uint64_t profiles_off;  /* uint8[n_thr], or 0 if no profile is given */
+} sc_header;
+
+typedef struct {
+    int n_thr;
+    int interval;
+    int heuristic;
+    int exec_time;
+    unsigned int seed;
+    int n_rcs;
+    char **names;   /* Name of every resource type */
+    int *max_available; /* Instances of every resource type */
+    unsigned char *profiles;    /* Workload profile of every thread(workload.h), or NULL if none is given */
+
+    /* Memory behind the tables */
+    void *map;  /* Mapped binary file */
+    size_t map_len;
+    char *text; /* Buffer of a text file */
+    bool own_tables;    /* max_available and profiles were allocated */
+} scenario;
+
+/**
+ * Function to release a scenario.
+ */
+static void sc_free(scenario *sc){
+    free(sc->names);
+    if(sc->own_tables){
+        free(sc->max_available);
+        free(sc->profiles);
+    }
+    free(sc->text);
+    if(sc->map != NULL)
+        munmap(sc->map, sc->map_len);
+    memset(sc, 0, sizeof(*sc));
+}
+
+/**
+ * Function to set up a scenario from the positional arguments of the command line, whose strings it points to.
+ * @param args threads, interval, heuristic, time, seed, number of resource types, then a name and instances per type
+ * @return Return false if there are fewer arguments than resource types announced, or memory is short.
+ */
+static inline bool sc_from_args(scenario *sc, int n_args, char **args){
+    memset(sc, 0, sizeof(*sc));
+    if(n_args < 6)
+        return false;
+    sc->n_thr = atoi(args[0]);
+    sc->interval = atoi(args[1]);
+    sc->heuristic = atoi(args[2]);
+    sc->exec_time = atoi(args[3]);
+    sc->seed = (unsigned int)atoi(args[4]);
+    sc->n_rcs = atoi(args[5]);
+    if(sc->n_rcs < 0 || n_args < 6 + 2 * sc->n_rcs)
+        return false;
+    sc->own_tables = true;
+    sc->names = (char **)malloc(sizeof(char *) * (sc->n_rcs > 0 ? sc->n_rcs : 1));
+    sc->max_available = (int *)malloc(sizeof(int) * (sc->n_rcs > 0 ? sc->n_rcs : 1));
+    if(sc->names == NULL || sc->max_available == NULL){
+        sc_free(sc);
+        return false;
+    }
+    for(int i = 0; i < sc->n_rcs; i++){
+        sc->names[i] = args[6 + 2 * i];
+        sc->max_available[i] = atoi(args[7 + 2 * i]);
+    }
+    return true;
+}
+
+static char *sc_token(char **s){
+    while(**s == ' ' || **s == '\t' || **s == '\r')
+        (*s)++;
+    if(**s == '\0')
+        return NULL;
+    char *tok = *s;
+    while(**s != '\0' && **s != ' ' && **s != '\t' && **s != '\r')
+        (*s)++;
+    if(**s != '\0')
+        *(*s)++ = '\0';
+    return tok;
+}
+
+/**
+ * Function to parse a scenario in text form, already in sc->text.
+ * @return Return true on success; on failure err describes the line at fault.
+ */
+static bool sc_parse_text(scenario *sc, char *err, size_t err_len){
+    int cap = 0, line_no = 0;
+    char *line = sc->text;
+    sc->own_tables = true;
+    sc->n_thr = -1;
+    while(line != NULL){
+        line_no++;
+        char *next = strchr(line, '\n');
+        if(next != NULL)
+            *next++ = '\0';
+        char *hash = strchr(line, '#');
+        if(hash != NULL)
+            *hash = '\0';
+        char *s = line;
+        char *key = sc_token(&s), *a = sc_token(&s), *b = sc_token(&s), *c = sc_token(&s);
+        line = next;
+        if(key == NULL)
+            continue;
+        bool ok = (a != NULL);
+        if(ok && strcmp(key, "threads") == 0){
+            sc->n_thr = atoi(a);
+            ok = (sc->n_thr > 0 && sc->profiles == NULL);
+        }else if(ok && strcmp(key, "interval") == 0){
+            sc->interval = atoi(a);
+        }else if(ok && strcmp(key, "heuristic") == 0){
+            sc->heuristic = atoi(a);
+        }else if(ok && strcmp(key, "time") == 0){
+            sc->exec_time = atoi(a);
+        }else if(ok && strcmp(key, "seed") == 0){
+            sc->seed = (unsigned int)atoi(a);
+        }else if(ok && strcmp(key, "resource") == 0 && b != NULL){
+            if(sc->n_rcs == cap){
+                cap = (cap > 0) ? 2 * cap : 64;
+                char **names = (char **)realloc(sc->names, sizeof(char *) * cap);
+                if(names != NULL)
+                    sc->names = names;
+                int *counts = (int *)realloc(sc->max_available, sizeof(int) * cap);
+                if(counts != NULL)
+                    sc->max_available = counts;
+                if(names == NULL || counts == NULL){
+                    snprintf(err, err_len, "Failed to allocate the resource table of the scenario.");
+                    return false;
+                }
+            }
+            sc->names[sc->n_rcs] = a;
+            sc->max_available[sc->n_rcs] = atoi(b);
+            ok = (sc->max_available[sc->n_rcs++] >= 0);
+        }else if(ok && strcmp(key, "profile") == 0 && sc->n_thr > 0){
+            int p = wl_find(a);
+            int first = (b != NULL) ? atoi(b) : 0;
+            int last = (c != NULL) ? atoi(c) : (b != NULL) ? first : sc->n_thr - 1;
+            ok = (p >= 0 && first >= 0 && first <= last && last < sc->n_thr);
+            if(ok && sc->profiles == NULL){
+                sc->profiles = (unsigned char *)calloc(sc->n_thr, 1);
+                ok = (sc->profiles != NULL);
+            }
+            if(ok)
+                memset(sc->profiles + first, p, last - first + 1);
+        }else{
+            ok = false;
+        }
+        if(!ok){
+            snprintf(err, err_len, "Invalid line %d of the scenario: %s", line_no, key);
+            return false;
+        }
+    }
+    if(sc->n_thr <= 0){
+        snprintf(err, err_len, "The scenario gives no number of threads.");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Function to check that a table of count entries of size bytes, at offset off, lies within a file of len bytes,
+ * without overflowing.
+ */
+static bool sc_fits(uint64_t off, uint64_t count, uint64_t size, uint64_t len){
+    return off <= len && count <= (len - off) / size;
+}
+
+/**
+ * Function to use a mapped scenario in binary form, checking that every table lies within the file.
+ * @return Return true on success.
+ */
+static bool sc_use_binary(scenario *sc, char *err, size_t err_len){
+    const sc_header *h = (const sc_header *)sc->map;
+    uint8_t *base = (uint8_t *)sc->map;
+    bool ok = (sc->map_len >= sizeof(sc_header) && h->magic == SC_MAGIC && h->version == SC_VERSION &&
+               h->n_thr > 0 && h->n_rcs >= 0);
+    uint64_t n_rcs = ok ? (uint64_t)h->n_rcs : 0;
+    ok = ok && h->counts_off % sizeof(int32_t) == 0 && h->names_off % sizeof(uint32_t) == 0 &&
+         sc_fits(h->counts_off, n_rcs, sizeof(int32_t), sc->map_len) &&
+         sc_fits(h->names_off, n_rcs, sizeof(uint32_t), sc->map_len) &&
+         sc_fits(h->pool_off, h->pool_len, 1, sc->map_len) &&
+         (h->pool_len == 0 || base[h->pool_off + h->pool_len - 1] == '\0') &&
+         (h->profiles_off == 0 || sc_fits(h->profiles_off, (uint64_t)h->n_thr, 1, sc->map_len));
+    if(!ok){
+        snprintf(err, err_len, "The scenario file is not a valid binary scenario of this version.");
+        return false;
+    }
+    sc->n_thr = h->n_thr;
+    sc->interval = h->interval;
+    sc->heuristic = h->heuristic;
+    sc->exec_time = h->exec_time;
+    sc->seed = h->seed;
+    sc->n_rcs = h->n_rcs;
+    sc->max_available = (int *)(base + h->counts_off);
+    sc->profiles = (h->profiles_off != 0) ? base + h->profiles_off : NULL;
+    sc->names = (char **)malloc(sizeof(char *) * (n_rcs > 0 ? n_rcs : 1));
+    if(sc->names == NULL){
+        snprintf(err, err_len, "Failed to allocate the resource table of the scenario.");
+        return false;
+    }
+    const uint32_t *offsets = (const uint32_t *)(base + h->names_off);
+    for(uint64_t i = 0; i < n_rcs; i++){
+        if(offsets[i] >= h->pool_len){
+            snprintf(err, err_len, "The scenario file is not a valid binary scenario of this version.");
+            return false;
+        }
+        sc->names[i] = (char *)base + h->pool_off + offsets[i];
+        if(sc->max_available[i] < 0){
+            snprintf(err, err_len, "The scenario file gives a negative number of instances to resource type %d.",
+                     (int)i);
+            return false;
+        }
+    }
+    if(sc->profiles != NULL){
+        for(int i = 0; i < sc->n_thr; i++){
+            if(sc->profiles[i] >= WL_N_PROFILES){
+                snprintf(err, err_len, "The scenario file gives an unknown profile to thread %d.", i);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Function to load a scenario file, in text or binary form.
+ * @param err Receives the reason of a failure
+ * @return Return true on success.
+ */
+static inline bool sc_load(scenario *sc, const char *path, char *err, size_t err_len){
+    memset(sc, 0, sizeof(*sc));
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if(fd < 0 || fstat(fd, &st) != 0){
+        if(fd >= 0)
+            close(fd);
+        snprintf(err, err_len, "Failed to open the scenario file %s.", path);
+        return false;
+    }
+    size_t len = (size_t)st.st_size;
+    uint32_t magic = 0;
+    bool binary = (len >= sizeof(sc_header) && pread(fd, &magic, sizeof(magic), 0) == sizeof(magic) &&
+                   magic == SC_MAGIC);
+    bool ok;
+    if(binary){
+        /* Private and writable, so that the tables can be used as the simulator's own arrays */
+        sc->map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        sc->map_len = len;
+        if(sc->map == MAP_FAILED)
+            sc->map = NULL;
+        ok = (sc->map != NULL) && sc_use_binary(sc, err, err_len);
+        if(sc->map == NULL)
+            snprintf(err, err_len, "Failed to map the scenario file %s.", path);
+    }else{
+        sc->text = (char *)malloc(len + 1);
+        ok = (sc->text != NULL && pread(fd, sc->text, len, 0) == (ssize_t)len);
+        if(ok){
+            sc->text[len] = '\0';
+            ok = sc_parse_text(sc, err, err_len);
+        }else{
+            snprintf(err, err_len, "Failed to read the scenario file %s.", path);
+        }
+    }
+    close(fd);
+    if(!ok)
+        sc_free(sc);
+    return ok;
+}
+
+/**
+ * Function to write a scenario in binary form.
+ * @return Return true on success.
+ */
+static inline bool sc_write_binary(const scenario *sc, const char *path){
+    uint64_t n_rcs = (uint64_t)sc->n_rcs;
+    uint64_t pool_len = 0;
+    for(uint64_t i = 0; i < n_rcs; i++){
+        pool_len += strlen(sc->names[i]) + 1;
+    }
+    sc_header h;
+    memset(&h, 0, sizeof(h));
+    h.magic = SC_MAGIC;
+    h.version = SC_VERSION;
+    h.n_thr = sc->n_thr;
+    h.interval = sc->interval;
+    h.heuristic = sc->heuristic;
+    h.exec_time = sc->exec_time;
+    h.seed = sc->seed;
+    h.n_rcs = sc->n_rcs;
+    h.counts_off = sizeof(sc_header);
+    h.names_off = h.counts_off + n_rcs * sizeof(int32_t);
+    h.pool_off = h.names_off + n_rcs * sizeof(uint32_t);
+    h.pool_len = pool_len;
+    h.profiles_off = (sc->profiles != NULL) ? h.pool_off + pool_len : 0;
+    size_t len = h.pool_off + pool_len + ((sc->profiles != NULL) ? (size_t)sc->n_thr : 0);
+
+    uint8_t *buf = (uint8_t *)calloc(len, 1);
+    if(buf == NULL)
+        return false;
+    memcpy(buf, &h, sizeof(h));
+    memcpy(buf + h.counts_off, sc->max_available, sizeof(int32_t) * n_rcs);
+    uint32_t *offsets = (uint32_t *)(buf + h.names_off);
+    uint64_t at = 0;
+    for(uint64_t i = 0; i < n_rcs; i++){
+        size_t n = strlen(sc->names[i]) + 1;
+        offsets[i] = (uint32_t)at;
+        memcpy(buf + h.pool_off + at, sc->names[i], n);
+        at += n;
+    }
+    if(sc->profiles != NULL)
+        memcpy(buf + h.profiles_off, sc->profiles, sc->n_thr);
+
+    FILE *f = fopen(path, "wb");
+    bool ok = (f != NULL && fwrite(buf, 1, len, f) == len);
+    if(f != NULL && fclose(f) != 0)
+        ok = false;
+    free(buf);
+    return ok;
+}
+
+#endif
@@ -0,0 +1,336 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+#include <stdbool.h>
+#include <limits.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_X86 1
+#endif
+
+/**
+ * Row kernels used by the detector and the victim selection heuristics:
+ *  row_le(a, b, n)  : true if a[j] <= b[j] for every j (the "request[i] <= work" test)
+ *  row_add(a, b, n) : a[j] += b[j] (the "work += allocation[i]" update)
+ *  row_sum/row_max/row_min(a, n) : reductions of a row
+ * The best implementation for the CPU (AVX-512, AVX2, SSE2 or scalar) is chosen at runtime, the first time any of the
+ * kernels is called.
+ */
+
+/* Scalar implementations, also used for the tails of the vector loops */
+static bool row_le_scalar(const int *a, const int *b, int n){
+    for(int j = 0; j < n; j++){
+        if(a[j] > b[j])
+            return false;
+    }
+    return true;
+}
+
+static void row_add_scalar(int *a, const int *b, int n){
+    for(int j = 0; j < n; j++){
+        a[j] += b[j];
+    }
+}
+
+static int row_sum_scalar(const int *a, int n){
+    int s = 0;
+    for(int j = 0; j < n; j++){
+        s += a[j];
+    }
+    return s;
+}
+
+static int row_max_scalar(const int *a, int n){
+    int m = INT_MIN;
+    for(int j = 0; j < n; j++){
+        m = (a[j] > m) ? a[j] : m;
+    }
+    return m;
+}
+
+static int row_min_scalar(const int *a, int n){
+    int m = INT_MAX;
+    for(int j = 0; j < n; j++){
+        m = (a[j] < m) ? a[j] : m;
+    }
+    return m;
+}
+
+#ifdef SIMD_X86
+
+/* SSE2: 4 lanes. SSE2 has no 32-bit min/max, so they are built from a compare and a blend. */
+static bool row_le_sse2(const int *a, const int *b, int n){
+    int j = 0;
+    for(; j + 4 <= n; j += 4){
+        __m128i gt = _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i *)(a + j)), _mm_loadu_si128((const __m128i *)(b + j)));
+        if(_mm_movemask_epi8(gt))
+            return false;
+    }
+    return row_le_scalar(a + j, b + j, n - j);
+}
+
+static void row_add_sse2(int *a, const int *b, int n){
+    int j = 0;
+    for(; j + 4 <= n; j += 4){
+        __m128i s = _mm_add_epi32(_mm_loadu_si128((const __m128i *)(a + j)), _mm_loadu_si128((const __m128i *)(b + j)));
+        _mm_storeu_si128((__m128i *)(a + j), s);
+    }
+    row_add_scalar(a + j, b + j, n - j);
+}
+
+static int row_sum_sse2(const int *a, int n){
+    __m128i acc = _mm_setzero_si128();
+    int j = 0;
+    for(; j + 4 <= n; j += 4){
+        acc = _mm_add_epi32(acc, _mm_loadu_si128((const __m128i *)(a + j)));
+    }
+    int lanes[4];
+    _mm_storeu_si128((__m128i *)lanes, acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + row_sum_scalar(a + j, n - j);
+}
+
+static inline __m128i sse2_max_epi32(__m128i x, __m128i y){
+    __m128i gt = _mm_cmpgt_epi32(x, y);
+    return _mm_or_si128(_mm_and_si128(gt, x), _mm_andnot_si128(gt, y));
+}
+
+static inline __m128i sse2_min_epi32(__m128i x, __m128i y){
+    __m128i gt = _mm_cmpgt_epi32(x, y);
+    return _mm_or_si128(_mm_and_si128(gt, y), _mm_andnot_si128(gt, x));
+}
+
+static int row_max_sse2(const int *a, int n){
+    __m128i acc = _mm_set1_epi32(INT_MIN);
+    int j = 0;
+    for(; j + 4 <= n; j += 4){
+        acc = sse2_max_epi32(acc, _mm_loadu_si128((const __m128i *)(a + j)));
+    }
+    int lanes[4];
+    _mm_storeu_si128((__m128i *)lanes, acc);
+    int m = row_max_scalar(a + j, n - j);
+    for(int k = 0; k < 4; k++){
+        m = (lanes[k] > m) ? lanes[k] : m;
+    }
+    return m;
+}
+
+static int row_min_sse2(const int *a, int n){
+    __m128i acc = _mm_set1_epi32(INT_MAX);
+    int j = 0;
+    for(; j + 4 <= n; j += 4){
+        acc = sse2_min_epi32(acc, _mm_loadu_si128((const __m128i *)(a + j)));
+    }
+    int lanes[4];
+    _mm_storeu_si128((__m128i *)lanes, acc);
+    int m = row_min_scalar(a + j, n - j);
+    for(int k = 0; k < 4; k++){
+        m = (lanes[k] < m) ? lanes[k] : m;
+    }
+    return m;
+}
+
+/* AVX2: 8 lanes */
+__attribute__((target("avx2")))
+static bool row_le_avx2(const int *a, const int *b, int n){
+    int j = 0;
+    for(; j + 8 <= n; j += 8){
+        __m256i gt = _mm256_cmpgt_epi32(_mm256_loadu_si256((const __m256i *)(a + j)),
+                                        _mm256_loadu_si256((const __m256i *)(b + j)));
+        if(!_mm256_testz_si256(gt, gt))
+            return false;
+    }
+    return row_le_scalar(a + j, b + j, n - j);
+}
+
+__attribute__((target("avx2")))
+static void row_add_avx2(int *a, const int *b, int n){
+    int j = 0;
+    for(; j + 8 <= n; j += 8){
+        __m256i s = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(a + j)),
+                                     _mm256_loadu_si256((const __m256i *)(b + j)));
+        _mm256_storeu_si256((__m256i *)(a + j), s);
+    }
+    row_add_scalar(a + j, b + j, n - j);
+}
+
+__attribute__((target("avx2")))
+static int row_sum_avx2(const int *a, int n){
+    __m256i acc = _mm256_setzero_si256();
+    int j = 0;
+    for(; j + 8 <= n; j += 8){
+        acc = _mm256_add_epi32(acc, _mm256_loadu_si256((const __m256i *)(a + j)));
+    }
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(s) + row_sum_scalar(a + j, n - j);
+}
+
+__attribute__((target("avx2")))
+static int row_max_avx2(const int *a, int n){
+    __m256i acc = _mm256_set1_epi32(INT_MIN);
+    int j = 0;
+    for(; j + 8 <= n; j += 8){
+        acc = _mm256_max_epi32(acc, _mm256_loadu_si256((const __m256i *)(a + j)));
+    }
+    __m128i m = _mm_max_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    m = _mm_max_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+    m = _mm_max_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+    int v = _mm_cvtsi128_si32(m), t = row_max_scalar(a + j, n - j);
+    return (v > t) ? v : t;
+}
+
+__attribute__((target("avx2")))
+static int row_min_avx2(const int *a, int n){
+    __m256i acc = _mm256_set1_epi32(INT_MAX);
+    int j = 0;
+    for(; j + 8 <= n; j += 8){
+        acc = _mm256_min_epi32(acc, _mm256_loadu_si256((const __m256i *)(a + j)));
+    }
+    __m128i m = _mm_min_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    m = _mm_min_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+    m = _mm_min_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+    int v = _mm_cvtsi128_si32(m), t = row_min_scalar(a + j, n - j);
+    return (v < t) ? v : t;
+}
+
+/* AVX-512: 16 lanes, the tails are handled with masked loads */
+__attribute__((target("avx512f")))
+static bool row_le_avx512(const int *a, const int *b, int n){
+    int j = 0;
+    for(; j + 16 <= n; j += 16){
+        if(_mm512_cmpgt_epi32_mask(_mm512_loadu_si512(a + j), _mm512_loadu_si512(b + j)))
+            return false;
+    }
+    __mmask16 k = (__mmask16)((1u << (n - j)) - 1);
+    return _mm512_mask_cmpgt_epi32_mask(k, _mm512_maskz_loadu_epi32(k, a + j), _mm512_maskz_loadu_epi32(k, b + j)) == 0;
+}
+
+__attribute__((target("avx512f")))
+static void row_add_avx512(int *a, const int *b, int n){
+    int j = 0;
+    for(; j + 16 <= n; j += 16){
+        _mm512_storeu_si512(a + j, _mm512_add_epi32(_mm512_loadu_si512(a + j), _mm512_loadu_si512(b + j)));
+    }
+    __mmask16 k = (__mmask16)((1u << (n - j)) - 1);
+    __m512i s = _mm512_add_epi32(_mm512_maskz_loadu_epi32(k, a + j), _mm512_maskz_loadu_epi32(k, b + j));
+    _mm512_mask_storeu_epi32(a + j, k, s);
+}
+
+__attribute__((target("avx512f")))
+static int row_sum_avx512(const int *a, int n){
+    __m512i acc = _mm512_setzero_si512();
+    int j = 0;
+    for(; j + 16 <= n; j += 16){
+        acc = _mm512_add_epi32(acc, _mm512_loadu_si512(a + j));
+    }
+    __mmask16 k = (__mmask16)((1u << (n - j)) - 1);
+    acc = _mm512_add_epi32(acc, _mm512_maskz_loadu_epi32(k, a + j));
+    return _mm512_reduce_add_epi32(acc);
+}
+
+__attribute__((target("avx512f")))
+static int row_max_avx512(const int *a, int n){
+    __m512i acc = _mm512_set1_epi32(INT_MIN);
+    int j = 0;
+    for(; j + 16 <= n; j += 16){
+        acc = _mm512_max_epi32(acc, _mm512_loadu_si512(a + j));
+    }
+    __mmask16 k = (__mmask16)((1u << (n - j)) - 1);
+    acc = _mm512_mask_max_epi32(acc, k, acc, _mm512_maskz_loadu_epi32(k, a + j));
+    return _mm512_reduce_max_epi32(acc);
+}
+
+__attribute__((target("avx512f")))
+static int row_min_avx512(const int *a, int n){
+    __m512i acc = _mm512_set1_epi32(INT_MAX);
+    int j = 0;
+    for(; j + 16 <= n; j += 16){
+        acc = _mm512_min_epi32(acc, _mm512_loadu_si512(a + j));
+    }
+    __mmask16 k = (__mmask16)((1u << (n - j)) - 1);
+    acc = _mm512_mask_min_epi32(acc, k, acc, _mm512_maskz_loadu_epi32(k, a + j));
+    return _mm512_reduce_min_epi32(acc);
+}
+
+#endif
+
+/* Runtime dispatch: every pointer starts at a resolver which selects the implementations and then forwards the call */
+static bool row_le_resolve(const int *a, const int *b, int n);
+static void row_add_resolve(int *a, const int *b, int n);
+static int row_sum_resolve(const int *a, int n);
+static int row_max_resolve(const int *a, int n);
+static int row_min_resolve(const int *a, int n);
+
+static bool (*row_le)(const int *a, const int *b, int n) = row_le_resolve;
+static void (*row_add)(int *a, const int *b, int n) = row_add_resolve;
+static int (*row_sum)(const int *a, int n) = row_sum_resolve;
+static int (*row_max)(const int *a, int n) = row_max_resolve;
+static int (*row_min)(const int *a, int n) = row_min_resolve;
+static const char *simd_isa = "scalar";    /* Name of the selected instruction set */
+static pthread_once_t simd_once = PTHREAD_ONCE_INIT;
+
+static void simd_select(void){
+    bool (*le)(const int *, const int *, int) = row_le_scalar;
+    void (*add)(int *, const int *, int) = row_add_scalar;
+    int (*sum)(const int *, int) = row_sum_scalar;
+    int (*mx)(const int *, int) = row_max_scalar;
+    int (*mn)(const int *, int) = row_min_scalar;
+    const char *isa = "scalar";
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f")){
+        le = row_le_avx512; add = row_add_avx512; sum = row_sum_avx512; mx = row_max_avx512; mn = row_min_avx512;
+        isa = "avx512";
+    }else if(__builtin_cpu_supports("avx2")){
+        le = row_le_avx2; add = row_add_avx2; sum = row_sum_avx2; mx = row_max_avx2; mn = row_min_avx2;
+        isa = "avx2";
+    }else if(__builtin_cpu_supports("sse2")){
+        le = row_le_sse2; add = row_add_sse2; sum = row_sum_sse2; mx = row_max_sse2; mn = row_min_sse2;
+        isa = "sse2";
+    }
+#endif
+    row_le = le;
+    row_add = add;
+    row_sum = sum;
+    row_max = mx;
+    row_min = mn;
+    simd_isa = isa;
+}
+
+/**
+ * Function to select the kernels for the CPU. It is called implicitly by the first kernel call, and may be called
+ * explicitly at startup to keep the selection off the hot path.
+ */
+static void simd_init(void){
+    pthread_once(&simd_once, simd_select);
+}
+
+static bool row_le_resolve(const int *a, const int *b, int n){
+    simd_init();
+    return row_le(a, b, n);
+}
+
+static void row_add_resolve(int *a, const int *b, int n){
+    simd_init();
+    row_add(a, b, n);
+}
+
+static int row_sum_resolve(const int *a, int n){
+    simd_init();
+    return row_sum(a, n);
+}
+
+static int row_max_resolve(const int *a, int n){
+    simd_init();
+    return row_max(a, n);
+}
+
+static int row_min_resolve(const int *a, int n){
+    simd_init();
+    return row_min(a, n);
+}
+
+#endif
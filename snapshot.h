@@ -0,0 +1,127 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <sched.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Sequence counters used to copy the shared state without locking it.
+ * rcs_seq[ri] is bumped around every write to column ri (available_rcs[ri] and the ri-th entries of allocation and
+ * request), row_seq[t] around every write of the request row of thread t that spans several columns. A counter is odd
+ * while its write is in progress. Writers of a counter are already serialised by the lock protecting what it covers,
+ * so the counters only need atomic loads and stores.
+ */
+typedef struct {
+    int n_rcs, n_thr;
+    unsigned int *rcs_seq;
+    unsigned int *row_seq;
+    unsigned int *seen;  /* Scratch: value of every counter when its part was last copied, columns first */
+} seq_table;
+
+static inline bool seq_init(seq_table *sq, int n_rcs, int n_thr){
+    sq->n_rcs = n_rcs;
+    sq->n_thr = n_thr;
+    sq->rcs_seq = (unsigned int *)calloc(n_rcs + n_thr + 1, sizeof(unsigned int));
+    sq->seen = (unsigned int *)calloc(n_rcs + n_thr + 1, sizeof(unsigned int));
+    if(sq->rcs_seq == NULL || sq->seen == NULL){
+        free(sq->rcs_seq);
+        free(sq->seen);
+        sq->rcs_seq = sq->row_seq = sq->seen = NULL;
+        return false;
+    }
+    sq->row_seq = sq->rcs_seq + n_rcs;
+    return true;
+}
+
+static void seq_destroy(seq_table *sq){
+    free(sq->rcs_seq);
+    free(sq->seen);
+    sq->rcs_seq = sq->row_seq = sq->seen = NULL;
+}
+
+static void seq_write_begin(unsigned int *seq){
+    __atomic_store_n(seq, __atomic_load_n(seq, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void seq_write_end(unsigned int *seq){
+    __atomic_store_n(seq, __atomic_load_n(seq, __ATOMIC_RELAXED) + 1, __ATOMIC_RELEASE);
+}
+
+/* Read a counter, waiting for an even value, i.e. for the write in progress to complete */
+static unsigned int seq_read_stable(const unsigned int *seq){
+    unsigned int v;
+    int spins = 0;
+    while((v = __atomic_load_n(seq, __ATOMIC_ACQUIRE)) & 1u){
+        if(++spins > 64)
+            sched_yield();
+    }
+    return v;
+}
+
+static void snap_copy_column(int j, int n_thr, int **alloc, int **req, const int *avail, int **d_alloc, int **d_req,
+                             int *d_avail){
+    d_avail[j] = avail[j];
+    for(int i = 0; i < n_thr; i++){
+        d_alloc[i][j] = alloc[i][j];
+        d_req[i][j] = req[i][j];
+    }
+}
+
+/**
+ * Function to take a consistent copy of the state without locking it.
+ * The whole state is copied once, then the counters are compared with their values before the copy. Only the columns
+ * and rows whose counter moved are copied again, until a complete pass finds every counter unchanged: at the start of
+ * that pass, every part of the copy matched the live state at the same instant.
+ * @param sq Sequence counters of the state
+ * @param alloc, req, avail Live state
+ * @param d_alloc, d_req, d_avail Destination of the copy
+ * @param max_passes Number of validation passes before giving up
+ * @return Return the number of parts copied again (zero when the first copy was consistent), or -1 if the state kept
+ * changing for max_passes passes and the copy is not consistent.
+ */
+static int snap_take_optimistic(seq_table *sq, int **alloc, int **req, const int *avail, int **d_alloc, int **d_req,
+                                int *d_avail, int max_passes){
+    int n_rcs = sq->n_rcs, n_thr = sq->n_thr;
+    unsigned int *seen = sq->seen;
+    for(int j = 0; j < n_rcs; j++){
+        seen[j] = seq_read_stable(&sq->rcs_seq[j]);
+    }
+    for(int i = 0; i < n_thr; i++){
+        seen[n_rcs + i] = seq_read_stable(&sq->row_seq[i]);
+    }
+    for(int i = 0; i < n_thr; i++){
+        memcpy(d_alloc[i], alloc[i], sizeof(int) * n_rcs);
+        memcpy(d_req[i], req[i], sizeof(int) * n_rcs);
+    }
+    memcpy(d_avail, avail, sizeof(int) * n_rcs);
+
+    int recopied = 0;
+    for(int pass = 0; pass < max_passes; pass++){
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        bool stable = true;
+        for(int j = 0; j < n_rcs; j++){
+            if(__atomic_load_n(&sq->rcs_seq[j], __ATOMIC_RELAXED) != seen[j]){
+                stable = false;
+                seen[j] = seq_read_stable(&sq->rcs_seq[j]);
+                snap_copy_column(j, n_thr, alloc, req, avail, d_alloc, d_req, d_avail);
+                recopied += 1;
+            }
+        }
+        for(int i = 0; i < n_thr; i++){
+            if(__atomic_load_n(&sq->row_seq[i], __ATOMIC_RELAXED) != seen[n_rcs + i]){
+                stable = false;
+                seen[n_rcs + i] = seq_read_stable(&sq->row_seq[i]);
+                memcpy(d_req[i], req[i], sizeof(int) * n_rcs);
+                recopied += 1;
+            }
+        }
+        if(stable)
+            return recopied;
+    }
+    return -1;
+}
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef STATE_STORE_H
+#define STATE_STORE_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SS_CACHE_LINE 64    /* Alignment of the matrices and of every row, in bytes */
+#define SS_LINE_INTS (SS_CACHE_LINE / (int)sizeof(int))
+#define SS_TILE 16  /* Tile size of the blocked transpose */
+#define SS_COMPACT_INTS 4   /* Row granularity of a compact store, in ints */
+
+/**
+ * Storage of the per-thread state matrices (allocation, request and cur_request).
+ * All three matrices live in one cache-line aligned block. Every row is padded to a whole number of cache lines so rows
+ * never share a line, and the row length is nudged off multiples of 4 KiB to avoid cache set aliasing between rows.
+ * The int** row views keep the familiar m[i][j] indexing while every row is a fixed offset into the same block.
+ * When rcs_major is set, a resource-major copy of request is kept as well, so that the detector can scan a column of
+ * the request matrix sequentially.
+ * A compact store only changes the padding: rows are padded to 16 bytes instead of a cache line, at the cost of rows
+ * sharing cache lines. The counts stay ints, so this saves memory only below 16 resource types, where most of a padded
+ * row is empty: 4 times with up to 4 resource types, nothing from 16 on.
+ */
+typedef struct {
+    int n_thr;  /* Number of rows (threads) */
+    int n_rcs;  /* Number of columns (resource types) */
+    int ld;     /* Padded length of a row, in ints */
+    int *block; /* allocation, request and cur_request, back to back */
+    int **rows; /* Row views into block: allocation rows, then request rows, then cur_request rows */
+    int **allocation;
+    int **request;
+    int **cur_request;  /* NULL if the store was allocated without it */
+
+    bool rcs_major; /* Maintain the resource-major copy of request */
+    int ld_t;   /* Padded length of a column of request_t, in ints */
+    int *request_t; /* request_t[j * ld_t + i] == request[i][j], refreshed by ss_sync_columns() */
+} state_store;
+
+/**
+ * Function to compute the padded length of a row holding n ints.
+ */
+static int ss_padded_len(int n){
+    int ld = ((n + SS_LINE_INTS - 1) / SS_LINE_INTS) * SS_LINE_INTS;
+    if(ld == 0)
+        ld = SS_LINE_INTS;
+    if((ld * sizeof(int)) % 4096 == 0)
+        ld += SS_LINE_INTS;
+    return ld;
+}
+
+static void* ss_aligned_calloc(size_t bytes){
+    bytes = ((bytes + SS_CACHE_LINE - 1) / SS_CACHE_LINE) * SS_CACHE_LINE;
+    void *p = aligned_alloc(SS_CACHE_LINE, bytes);
+    if(p != NULL)
+        memset(p, 0, bytes);
+    return p;
+}
+
+/**
+ * Function to compute the length of a row of a compact store holding n ints.
+ */
+static int ss_compact_len(int n){
+    int ld = ((n + SS_COMPACT_INTS - 1) / SS_COMPACT_INTS) * SS_COMPACT_INTS;
+    return (ld == 0) ? SS_COMPACT_INTS : ld;
+}
+
+/**
+ * Function to allocate the state matrices, all zero.
+ * @param ss Store to initialise
+ * @param n_thr Number of threads
+ * @param n_rcs Number of resource types
+ * @param rcs_major Whether a resource-major copy of request is maintained for column scans
+ * @param compact Whether rows are padded to 16 bytes instead of whole cache lines
+ * @param with_cur Whether cur_request is allocated
+ * @return Return true on success, false if the memory could not be allocated.
+ */
+static bool ss_init_ex(state_store *ss, int n_thr, int n_rcs, bool rcs_major, bool compact, bool with_cur){
+    memset(ss, 0, sizeof(*ss));
+    ss->n_thr = n_thr;
+    ss->n_rcs = n_rcs;
+    ss->ld = compact ? ss_compact_len(n_rcs) : ss_padded_len(n_rcs);
+    int n_mat = with_cur ? 3 : 2;
+    ss->block = (int *)ss_aligned_calloc(sizeof(int) * n_mat * (size_t)n_thr * ss->ld);
+    ss->rows = (int **)malloc(sizeof(int *) * n_mat * (n_thr > 0 ? n_thr : 1));
+    if(ss->block == NULL || ss->rows == NULL){
+        free(ss->block);
+        free(ss->rows);
+        return false;
+    }
+    for(int i = 0; i < n_mat * n_thr; i++){
+        ss->rows[i] = ss->block + (size_t)i * ss->ld;
+    }
+    ss->allocation = ss->rows;
+    ss->request = ss->rows + n_thr;
+    ss->cur_request = with_cur ? ss->rows + 2 * n_thr : NULL;
+
+    ss->rcs_major = rcs_major;
+    if(rcs_major){
+        ss->ld_t = ss_padded_len(n_thr);
+        ss->request_t = (int *)ss_aligned_calloc(sizeof(int) * (size_t)n_rcs * ss->ld_t);
+        if(ss->request_t == NULL){
+            free(ss->block);
+            free(ss->rows);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Function to release the memory held by the store.
+ */
+static void ss_destroy(state_store *ss){
+    free(ss->block);
+    free(ss->rows);
+    free(ss->request_t);
+    memset(ss, 0, sizeof(*ss));
+}
+
+/**
+ * Function to refresh the resource-major copy of request. The transpose is done tile by tile so that both the rows read
+ * and the columns written stay in cache.
+ */
+static inline void ss_sync_columns(state_store *ss){
+    if(!ss->rcs_major)
+        return;
+    for(int i0 = 0; i0 < ss->n_thr; i0 += SS_TILE){
+        int i1 = (i0 + SS_TILE < ss->n_thr) ? i0 + SS_TILE : ss->n_thr;
+        for(int j0 = 0; j0 < ss->n_rcs; j0 += SS_TILE){
+            int j1 = (j0 + SS_TILE < ss->n_rcs) ? j0 + SS_TILE : ss->n_rcs;
+            for(int i = i0; i < i1; i++){
+                const int *row = ss->request[i];
+                for(int j = j0; j < j1; j++){
+                    ss->request_t[(size_t)j * ss->ld_t + i] = row[j];
+                }
+            }
+        }
+    }
+}
+
+#endif
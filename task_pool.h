@@ -0,0 +1,239 @@
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "des.h"
+
+/*
+ * Work-stealing pool running many tasks on a few threads.
+ * A task is a number from 0 to n_tasks - 1, and running it calls run(task), which does a bounded amount of work and
+ * returns: it either sleeps with tp_sleep(), is made ready again with tp_submit(), or parks, in which case whoever
+ * wakes it calls tp_submit(). Every worker thread has a run queue and a timer heap. A worker runs the ready tasks of
+ * its queue in FIFO order, so that no task starves, and when it has none it steals the oldest task of another worker. A
+ * task is never ready in two queues at once, and each queue can hold every task. Tasks put to sleep go to the timer
+ * heap of the worker that ran them, which moves them to its run queue when they are due. A worker with nothing to run
+ * waits on a condition variable until its next timer, or until a task is submitted.
+ */
+typedef struct {
+    pthread_mutex_t lock;   /* Protects the run queue */
+    int *ring;  /* Run queue, a FIFO ring */
+    int head;
+    int len;
+    des_queue timers;   /* Sleeping tasks, by the time at which they are due; only touched by the owner */
+    unsigned int seed;  /* Choice of the workers to steal from */
+    long steals;
+    pthread_t id;
+} tp_worker;
+
+typedef struct {
+    int n_workers, n_tasks;
+    tp_worker *workers;
+    void (*run)(int task);
+    pthread_mutex_t idle_lock;
+    pthread_cond_t idle_cond;   /* Signalled when a task is submitted while a worker is idle */
+    int n_idle;
+    int next;   /* Next worker to receive a task submitted from outside the pool */
+} task_pool;
+
+static __thread int tp_self = -1;   /* Index of the worker running on this thread, -1 outside the pool */
+
+static double tp_now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Function to set up a pool, without starting its threads.
+ * @param n_workers Number of worker threads
+ * @param n_tasks Number of tasks
+ * @param run Function running a task until it sleeps, yields or parks
+ * @return Return true on success.
+ */
+static bool tp_init(task_pool *tp, int n_workers, int n_tasks, void (*run)(int task)){
+    tp->n_workers = (n_workers > 0) ? n_workers : 1;
+    tp->n_tasks = n_tasks;
+    tp->run = run;
+    tp->n_idle = 0;
+    tp->next = 0;
+    pthread_mutex_init(&tp->idle_lock, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&tp->idle_cond, &attr);
+    pthread_condattr_destroy(&attr);
+    tp->workers = (tp_worker *)calloc(tp->n_workers, sizeof(tp_worker));
+    if(tp->workers == NULL)
+        return false;
+    for(int w = 0; w < tp->n_workers; w++){
+        tp_worker *wk = &tp->workers[w];
+        pthread_mutex_init(&wk->lock, NULL);
+        wk->ring = (int *)malloc(sizeof(int) * (n_tasks > 0 ? n_tasks : 1));
+        wk->seed = 2654435761u * (w + 1);
+        if(wk->ring == NULL || !des_init(&wk->timers, 64))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Function to make a task ready. From a worker, the task goes to the worker's own queue; from outside the pool, the
+ * workers take turns.
+ */
+static void tp_submit(task_pool *tp, int task){
+    int w = tp_self;
+    if(w < 0)
+        w = (int)((unsigned int)__atomic_fetch_add(&tp->next, 1, __ATOMIC_RELAXED) % tp->n_workers);
+    tp_worker *wk = &tp->workers[w];
+    pthread_mutex_lock(&wk->lock);
+    wk->ring[(wk->head + wk->len) % tp->n_tasks] = task;
+    __atomic_store_n(&wk->len, wk->len + 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&wk->lock);
+    /* An idle worker checks the queues after declaring itself idle, so one of the two always sees the other */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&tp->n_idle, __ATOMIC_SEQ_CST) > 0){
+        pthread_mutex_lock(&tp->idle_lock);
+        pthread_cond_signal(&tp->idle_cond);
+        pthread_mutex_unlock(&tp->idle_lock);
+    }
+}
+
+/**
+ * Function to put the running task to sleep for a while. Must be called by the task, from its worker.
+ * @return Return false if the timer heap could not grow.
+ */
+static bool tp_sleep(task_pool *tp, int task, double sec){
+    return des_push(&tp->workers[tp_self].timers, tp_now() + sec, 0, task);
+}
+
+/**
+ * Function to take the oldest task of a run queue.
+ * @return Return the task, or -1 if the queue is empty.
+ */
+static int tp_take(task_pool *tp, tp_worker *wk){
+    if(__atomic_load_n(&wk->len, __ATOMIC_SEQ_CST) == 0)
+        return -1;
+    int task = -1;
+    pthread_mutex_lock(&wk->lock);
+    if(wk->len > 0){
+        task = wk->ring[wk->head];
+        wk->head = (wk->head + 1) % tp->n_tasks;
+        __atomic_store_n(&wk->len, wk->len - 1, __ATOMIC_SEQ_CST);
+    }
+    pthread_mutex_unlock(&wk->lock);
+    return task;
+}
+
+/**
+ * Function to move the due tasks of a worker's timer heap to its run queue.
+ * @return Return the time at which the next timer is due, or 0 if there is none.
+ */
+static double tp_fire_timers(task_pool *tp, tp_worker *wk){
+    double now = tp_now();
+    des_event e;
+    while(wk->timers.len > 0){
+        if(wk->timers.heap[0].t > now)
+            return wk->timers.heap[0].t;
+        des_pop(&wk->timers, &e);
+        tp_submit(tp, e.who);
+    }
+    return 0;
+}
+
+/**
+ * Function to find a ready task, stealing from the other workers when the own queue is empty.
+ * @return Return the task, or -1 if there is none.
+ */
+static int tp_find(task_pool *tp, int self){
+    int task = tp_take(tp, &tp->workers[self]);
+    for(int k = 0; task < 0 && k < tp->n_workers - 1; k++){
+        int victim = (int)(rand_r(&tp->workers[self].seed) % tp->n_workers);
+        if(victim == self)
+            continue;
+        task = tp_take(tp, &tp->workers[victim]);
+        if(task >= 0)
+            __atomic_add_fetch(&tp->workers[self].steals, 1, __ATOMIC_RELAXED);
+    }
+    return task;
+}
+
+static bool tp_any_ready(task_pool *tp){
+    for(int w = 0; w < tp->n_workers; w++){
+        if(__atomic_load_n(&tp->workers[w].len, __ATOMIC_SEQ_CST) > 0)
+            return true;
+    }
+    return false;
+}
+
+static void* tp_worker_main(void *arg){
+    task_pool *tp = ((void **)arg)[0];
+    int self = (int)(long)((void **)arg)[1];
+    free(arg);
+    tp_self = self;
+    /* The signal handlers take the locks of the state, so they must never interrupt a task holding them */
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGALRM);
+    sigaddset(&set, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+    tp_worker *wk = &tp->workers[self];
+    while(true){
+        double next_timer = tp_fire_timers(tp, wk);
+        int task = tp_find(tp, self);
+        if(task >= 0){
+            tp->run(task);
+            continue;
+        }
+        /* Idle: waiting for a submission, or for the next timer */
+        pthread_mutex_lock(&tp->idle_lock);
+        __atomic_add_fetch(&tp->n_idle, 1, __ATOMIC_SEQ_CST);
+        if(!tp_any_ready(tp)){
+            if(next_timer > 0){
+                struct timespec until;
+                until.tv_sec = (time_t)next_timer;
+                until.tv_nsec = (long)((next_timer - until.tv_sec) * 1e9);
+                pthread_cond_timedwait(&tp->idle_cond, &tp->idle_lock, &until);
+            }else{
+                pthread_cond_wait(&tp->idle_cond, &tp->idle_lock);
+            }
+        }
+        __atomic_sub_fetch(&tp->n_idle, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&tp->idle_lock);
+    }
+    return NULL;
+}
+
+/**
+ * Function to start the worker threads of a pool.
+ * @return Return true on success.
+ */
+static bool tp_start(task_pool *tp){
+    for(int w = 0; w < tp->n_workers; w++){
+        void **arg = (void **)malloc(2 * sizeof(void *));
+        if(arg == NULL)
+            return false;
+        arg[0] = tp;
+        arg[1] = (void *)(long)w;
+        if(pthread_create(&tp->workers[w].id, NULL, tp_worker_main, arg) != 0)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Function to get the number of tasks taken from the queue of another worker.
+ */
+static long tp_steals(task_pool *tp){
+    long n = 0;
+    for(int w = 0; w < tp->n_workers; w++){
+        n += __atomic_load_n(&tp->workers[w].steals, __ATOMIC_RELAXED);
+    }
+    return n;
+}
+
+#endif
@@ -0,0 +1,162 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * Binary trace of a run, replayable through the detector.
+ * The trace file is memory-mapped and append-only: a header describing the system, followed by fixed-size records.
+ * A writer reserves its records with an atomic add on the record count and fills them in place, without locks or
+ * system calls. Records are reserved under the lock protecting the state change they describe, so the order of the
+ * records is an order in which the changes can be applied one after the other. The file is sized sparsely to its
+ * capacity up front, and cut to the records written when the trace is closed; records beyond the capacity are dropped
+ * and counted. The kind of a record is never 0, so a reader of a file that was not closed stops at the first zero
+ * record.
+ *
+ * Records:
+ *   TR_SET       thr generated a new request set, followed by one TR_CLAIM per resource type it requests
+ *   TR_CLAIM     thr requests count instances of rcs in its request set
+ *   TR_GRANT     count instances of rcs allocated to thr
+ *   TR_RELEASE   count instances of rcs released by thr
+ *   TR_CHECK     the detector found count threads in deadlock (0 if none)
+ *   TR_TERMINATE thr terminated by the detector
+ */
+
+#define TR_MAGIC 0x52544c44u    /* "DLTR" */
+#define TR_VERSION 1
+
+enum {
+    TR_SET = 1,
+    TR_CLAIM,
+    TR_GRANT,
+    TR_RELEASE,
+    TR_CHECK,
+    TR_TERMINATE
+};
+
+typedef struct {
+    uint64_t ts;    /* Time since the start of the trace, in ns of the simulation clock */
+    int32_t kind;
+    int32_t thr;
+    int32_t rcs;
+    int32_t count;
+} tr_record;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t record_size;
+    int32_t n_thr;
+    int32_t n_rcs;
+    int32_t heuristic;
+    uint64_t data_offset;   /* Offset of the first record; max_available follows this header */
+    uint64_t n_records; /* Number of records, written when the trace is closed */
+    uint64_t dropped;
+} tr_header;
+
+typedef struct {
+    int fd;
+    uint8_t *map;
+    size_t map_len;
+    tr_header *header;
+    tr_record *records;
+    uint64_t capacity;  /* In records */
+    uint64_t n_records; /* Records reserved */
+    uint64_t dropped;
+} trace_log;
+
+/**
+ * Function to create a trace file.
+ * @param path Path of the file
+ * @param capacity Maximum number of records
+ * @param max_available Instances of every resource type
+ * @return Return true on success.
+ */
+static inline bool tr_open(trace_log *tr, const char *path, uint64_t capacity, int n_thr, int n_rcs, int heuristic,
+                    const int *max_available){
+    memset(tr, 0, sizeof(*tr));
+    tr->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(tr->fd < 0)
+        return false;
+    uint64_t offset = sizeof(tr_header) + sizeof(int32_t) * (uint64_t)n_rcs;
+    offset = (offset + sizeof(tr_record) - 1) / sizeof(tr_record) * sizeof(tr_record);
+    tr->capacity = capacity;
+    tr->map_len = offset + capacity * sizeof(tr_record);
+    if(ftruncate(tr->fd, (off_t)tr->map_len) != 0)
+        return false;
+    tr->map = (uint8_t *)mmap(NULL, tr->map_len, PROT_READ | PROT_WRITE, MAP_SHARED, tr->fd, 0);
+    if(tr->map == MAP_FAILED){
+        tr->map = NULL;
+        return false;
+    }
+    tr->header = (tr_header *)tr->map;
+    tr->records = (tr_record *)(tr->map + offset);
+    tr_header h = {TR_MAGIC, TR_VERSION, sizeof(tr_record), n_thr, n_rcs, heuristic, offset, 0, 0};
+    *tr->header = h;
+    memcpy(tr->map + sizeof(tr_header), max_available, sizeof(int32_t) * n_rcs);
+    return true;
+}
+
+static bool tr_enabled(const trace_log *tr){
+    return tr->map != NULL;
+}
+
+/**
+ * Function to reserve consecutive records.
+ * @return Return the first record, or NULL if the trace is full.
+ */
+static tr_record *tr_reserve(trace_log *tr, int n){
+    uint64_t idx = __atomic_fetch_add(&tr->n_records, n, __ATOMIC_RELAXED);
+    if(idx + n > tr->capacity){
+        __atomic_add_fetch(&tr->dropped, n, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    return &tr->records[idx];
+}
+
+static void tr_fill(tr_record *r, uint64_t ts, int kind, int thr, int rcs, int count){
+    r->ts = ts;
+    r->thr = thr;
+    r->rcs = rcs;
+    r->count = count;
+    __atomic_store_n(&r->kind, kind, __ATOMIC_RELEASE);
+}
+
+/**
+ * Function to append a record.
+ */
+static void tr_emit(trace_log *tr, uint64_t ts, int kind, int thr, int rcs, int count){
+    tr_record *r = tr_reserve(tr, 1);
+    if(r != NULL)
+        tr_fill(r, ts, kind, thr, rcs, count);
+}
+
+/**
+ * Function to close the trace, cutting the file to the records written.
+ */
+static void tr_close(trace_log *tr){
+    if(tr->map == NULL)
+        return;
+    uint64_t n = __atomic_load_n(&tr->n_records, __ATOMIC_ACQUIRE);
+    if(n > tr->capacity)
+        n = tr->capacity;
+    tr->header->n_records = n;
+    tr->header->dropped = tr->dropped;
+    uint64_t len = tr->header->data_offset + n * sizeof(tr_record);
+    msync(tr->map, tr->map_len, MS_SYNC);
+    munmap(tr->map, tr->map_len);
+    if(ftruncate(tr->fd, (off_t)len) != 0){
+        /* The file keeps its full size; readers stop at the first zero record */
+    }
+    close(tr->fd);
+    tr->map = NULL;
+}
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef VICTIM_SELECT_H
+#define VICTIM_SELECT_H
+
+#include <limits.h>
+#include <stdbool.h>
+
+#include "alloc_stats.h"
+#include "simd_kernels.h"
+
+/*
+ * Heuristics choosing the thread of a deadlock to terminate, on any allocation matrix.
+ * The deadlocked threads are listed in thr_in_dlock[], ended by -1 or by the n_thr-th entry. When as is given, it holds
+ * the aggregates of the rows of alloc and the heuristics read them in O(1); otherwise every row is scanned.
+ *
+ * Heuristics:
+ *   VS_MAX_TOTAL   maximum number of total instances allocated
+ *   VS_MAX_ANY     maximum instances of any resource type allocated
+ *   VS_MIN_TOTAL   minimum number of total instances allocated
+ *   VS_MIN_ANY     minimum instances of any resource type allocated
+ *   VS_LINEAR      first deadlocked thread
+ */
+enum {
+    VS_MAX_TOTAL = 1,
+    VS_MAX_ANY,
+    VS_MIN_TOTAL,
+    VS_MIN_ANY,
+    VS_LINEAR
+};
+
+static int vs_total(int **alloc, int n_rcs, const alloc_stats *as, int t){
+    return (as != NULL) ? as->total[t] : row_sum(alloc[t], n_rcs);
+}
+
+static int vs_max(int **alloc, int n_rcs, const alloc_stats *as, int t){
+    return (as != NULL) ? as->max[t] : row_max(alloc[t], n_rcs);
+}
+
+static int vs_min(int **alloc, int n_rcs, const alloc_stats *as, int t){
+    return (as != NULL) ? as->min[t] : row_min(alloc[t], n_rcs);
+}
+
+/**
+ * Function to find the deadlocked thread with the largest, or the smallest, value of an aggregate of its allocation.
+ * Ties go to the first thread listed.
+ * @param largest Whether the largest value is looked for
+ * @return Return the index of the thread.
+ */
+static int vs_extreme(int **alloc, int n_rcs, const alloc_stats *as, const int thr_in_dlock[], int n_thr,
+                      int (*value)(int **, int, const alloc_stats *, int), bool largest){
+    int best = largest ? 0 : INT_MAX, best_thr = thr_in_dlock[0];
+    for(int i = 0; i < n_thr; i++){
+        if(thr_in_dlock[i] == -1){
+            break;
+        }
+        int v = value(alloc, n_rcs, as, thr_in_dlock[i]);
+        if(largest ? (v > best) : (v < best)){
+            best = v;
+            best_thr = thr_in_dlock[i];
+        }
+    }
+    return best_thr;
+}
+
+/**
+ * Function to return the thread of a deadlock to be terminated.
+ * @param heuristic One of VS_MAX_TOTAL to VS_LINEAR
+ * @param alloc Allocation matrix the heuristic is evaluated on
+ * @param as Aggregates of alloc, or NULL
+ * @param thr_in_dlock Array containing the indexes of the threads involved in the deadlock
+ * @param n_thr Length of thr_in_dlock[]
+ * @return Return the index of the thread to terminate.
+ */
+static int vs_select(int heuristic, int **alloc, int n_rcs, const alloc_stats *as, const int thr_in_dlock[], int n_thr){
+    switch(heuristic){
+        case VS_MAX_TOTAL: return vs_extreme(alloc, n_rcs, as, thr_in_dlock, n_thr, vs_total, true);
+        case VS_MAX_ANY: return vs_extreme(alloc, n_rcs, as, thr_in_dlock, n_thr, vs_max, true);
+        case VS_MIN_TOTAL: return vs_extreme(alloc, n_rcs, as, thr_in_dlock, n_thr, vs_total, false);
+        case VS_MIN_ANY: return vs_extreme(alloc, n_rcs, as, thr_in_dlock, n_thr, vs_min, false);
+        default: return thr_in_dlock[0];
+    }
+}
+
+#endif
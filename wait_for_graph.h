@@ -0,0 +1,165 @@
+#ifndef WAIT_FOR_GRAPH_H
+#define WAIT_FOR_GRAPH_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/**
+ * Wait-for graph, used instead of the matrix reduction when every resource type has a single instance.
+ * A resource type then has at most one holder, and a blocked thread waits on exactly one resource type, so every thread
+ * has at most one out-edge: blocked thread -> holder of the resource it waits on. The edges are kept implicitly by
+ * holder[] and blocked_on[]. A cycle can only be closed by the out-edge of a thread that blocks, since a thread that
+ * is granted a resource is running and has no out-edge, so cycles are found on insertion by following the chain of
+ * out-edges from the new holder, in at most one step per thread of the chain.
+ * The thread that closed a cycle is pushed as a root for the detector. The graph has its own lock, always taken last.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    int n_thr, n_rcs;
+    int *holder;    /* Thread holding every resource type, -1 if none */
+    int *blocked_on;    /* Resource type every thread waits on, -1 if it is not blocked */
+    int *roots; /* Threads that closed a cycle, not yet examined by the detector */
+    bool *is_root;
+    int n_roots;
+    long cycles;    /* Number of cycles found */
+} wait_for_graph;
+
+static inline bool wfg_init(wait_for_graph *g, int n_thr, int n_rcs){
+    pthread_mutex_init(&g->lock, NULL);
+    g->n_thr = n_thr;
+    g->n_rcs = n_rcs;
+    g->n_roots = 0;
+    g->cycles = 0;
+    g->holder = (int *)malloc(sizeof(int) * (n_rcs > 0 ? n_rcs : 1));
+    g->blocked_on = (int *)malloc(sizeof(int) * (n_thr > 0 ? n_thr : 1));
+    g->roots = (int *)malloc(sizeof(int) * (n_thr > 0 ? n_thr : 1));
+    g->is_root = (bool *)calloc(n_thr > 0 ? n_thr : 1, sizeof(bool));
+    if(g->holder == NULL || g->blocked_on == NULL || g->roots == NULL || g->is_root == NULL)
+        return false;
+    for(int j = 0; j < n_rcs; j++){
+        g->holder[j] = -1;
+    }
+    for(int i = 0; i < n_thr; i++){
+        g->blocked_on[i] = -1;
+    }
+    return true;
+}
+
+static void wfg_destroy(wait_for_graph *g){
+    pthread_mutex_destroy(&g->lock);
+    free(g->holder);
+    free(g->blocked_on);
+    free(g->roots);
+    free(g->is_root);
+    g->holder = g->blocked_on = g->roots = NULL;
+    g->is_root = NULL;
+}
+
+/**
+ * Function to follow the out-edges from thread t, with the lock held.
+ * @return Return true if the chain comes back to t, i.e. t is on a cycle.
+ */
+static bool wfg_on_cycle(const wait_for_graph *g, int t){
+    int u = t;
+    for(int steps = 0; steps <= g->n_thr; steps++){
+        int r = g->blocked_on[u];
+        if(r < 0)
+            return false;
+        u = g->holder[r];
+        if(u < 0)
+            return false;
+        if(u == t)
+            return true;
+    }
+    return false;   /* Reached a cycle that does not contain t */
+}
+
+/**
+ * Function to record that thread thr holds resource type ri.
+ */
+static void wfg_grant(wait_for_graph *g, int thr, int ri){
+    pthread_mutex_lock(&g->lock);
+    g->holder[ri] = thr;
+    pthread_mutex_unlock(&g->lock);
+}
+
+/**
+ * Function to record that thread thr no longer holds resource type ri.
+ */
+static void wfg_release(wait_for_graph *g, int thr, int ri){
+    pthread_mutex_lock(&g->lock);
+    if(g->holder[ri] == thr)
+        g->holder[ri] = -1;
+    pthread_mutex_unlock(&g->lock);
+}
+
+/**
+ * Function to add the out-edge of a thread blocking on resource type ri, checking whether it closes a cycle.
+ * @return Return true if a cycle was closed.
+ */
+static bool wfg_block(wait_for_graph *g, int thr, int ri){
+    pthread_mutex_lock(&g->lock);
+    g->blocked_on[thr] = ri;
+    bool cycle = wfg_on_cycle(g, thr);
+    if(cycle){
+        g->cycles += 1;
+        if(!g->is_root[thr]){
+            g->is_root[thr] = true;
+            g->roots[g->n_roots++] = thr;
+        }
+    }
+    pthread_mutex_unlock(&g->lock);
+    return cycle;
+}
+
+/**
+ * Function to remove the out-edge of a thread, once granted or terminated.
+ */
+static void wfg_unblock(wait_for_graph *g, int thr){
+    pthread_mutex_lock(&g->lock);
+    g->blocked_on[thr] = -1;
+    pthread_mutex_unlock(&g->lock);
+}
+
+/**
+ * Function to check whether cycles are waiting for the detector, without taking the lock.
+ */
+static bool wfg_pending(wait_for_graph *g){
+    return __atomic_load_n(&g->n_roots, __ATOMIC_RELAXED) > 0;
+}
+
+static int wfg_int_cmp(const void *a, const void *b){
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Function to get a cycle of the graph. Roots are popped until one is still on a cycle; roots whose cycle was broken
+ * in the meantime are discarded.
+ * @param members Array receiving the threads of the cycle, in ascending order
+ * @return Return the number of threads in the cycle, 0 if there is none.
+ */
+static int wfg_take_cycle(wait_for_graph *g, int members[]){
+    pthread_mutex_lock(&g->lock);
+    int k = 0;
+    while(g->n_roots > 0 && k == 0){
+        int t = g->roots[g->n_roots - 1];
+        if(wfg_on_cycle(g, t)){
+            int u = t;
+            do{
+                members[k++] = u;
+                u = g->holder[g->blocked_on[u]];
+            }while(u != t);
+            /* The root stays queued until its cycle is broken */
+            break;
+        }
+        g->is_root[t] = false;
+        g->n_roots -= 1;
+    }
+    pthread_mutex_unlock(&g->lock);
+    qsort(members, k, sizeof(int), wfg_int_cmp);
+    return k;
+}
+
+#endif
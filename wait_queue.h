@@ -0,0 +1,147 @@
+#ifndef WAIT_QUEUE_H
+#define WAIT_QUEUE_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+struct wait_queue;
+
+/* A thread blocked on a resource type. Every worker owns exactly one waiter, since it waits on one resource at a time. */
+typedef struct wq_waiter {
+    int thr;    /* Index of the waiting thread */
+    int need;   /* Number of instances the thread is waiting for */
+    bool signalled; /* Set by the waker before signalling cond */
+    pthread_cond_t cond;    /* Private condition variable, so that a wake-up reaches this waiter only */
+    void (*on_wake)(struct wq_waiter *w);   /* Called instead of signalling cond, for waiters that are not threads */
+    struct wait_queue *queue;   /* Queue the waiter is linked in, NULL if not waiting */
+    struct wq_waiter *prev, *next;
+} wq_waiter;
+
+/* FIFO of the threads waiting on one resource type */
+typedef struct wait_queue {
+    wq_waiter *head, *tail;
+    int len;
+} wait_queue;
+
+static inline void wq_init(wait_queue *q){
+    q->head = q->tail = NULL;
+    q->len = 0;
+}
+
+static inline void wq_waiter_init(wq_waiter *w, int thr){
+    w->thr = thr;
+    w->need = 0;
+    w->signalled = false;
+    w->on_wake = NULL;
+    w->queue = NULL;
+    w->prev = w->next = NULL;
+    pthread_cond_init(&w->cond, NULL);
+}
+
+static inline void wq_waiter_destroy(wq_waiter *w){
+    pthread_cond_destroy(&w->cond);
+}
+
+static void wq_unlink(wq_waiter *w){
+    wait_queue *q = w->queue;
+    if(w->prev) w->prev->next = w->next;
+    else q->head = w->next;
+    if(w->next) w->next->prev = w->prev;
+    else q->tail = w->prev;
+    w->prev = w->next = NULL;
+    w->queue = NULL;
+    q->len -= 1;
+}
+
+/**
+ * Function to wake a waiter that was unlinked from its queue.
+ */
+static void wq_signal(wq_waiter *w){
+    w->signalled = true;
+    if(w->on_wake != NULL)
+        w->on_wake(w);
+    else
+        pthread_cond_signal(&w->cond);
+}
+
+/**
+ * Function to link a waiter into a resource queue, without blocking. Used directly by the discrete-event simulation
+ * and the tasks of the M:N mode, whose waiters are not threads. Must be called with the mutex protecting the queue held.
+ * @param q Queue of the resource type
+ * @param w Waiter of the calling thread
+ * @param need Number of instances the thread is waiting for
+ * @param front Enqueue at the head instead of the tail, used by a woken waiter whose grant was taken by another thread
+ * so that it keeps its place in the FIFO order
+ */
+static void wq_push(wait_queue *q, wq_waiter *w, int need, bool front){
+    w->need = need;
+    w->signalled = false;
+    w->queue = q;
+    if(front){
+        w->prev = NULL;
+        w->next = q->head;
+        if(q->head) q->head->prev = w;
+        else q->tail = w;
+        q->head = w;
+    }else{
+        w->next = NULL;
+        w->prev = q->tail;
+        if(q->tail) q->tail->next = w;
+        else q->head = w;
+        q->tail = w;
+    }
+    q->len += 1;
+}
+
+/**
+ * Function to block the calling thread on a resource queue until it is woken by wq_wake() or wq_cancel().
+ * Must be called with the mutex protecting the queue held; the mutex is released while waiting.
+ * @param q Queue of the resource type
+ * @param w Waiter of the calling thread
+ * @param need Number of instances the thread is waiting for
+ * @param front Enqueue at the head instead of the tail, see wq_push()
+ * @param m Mutex protecting the queue
+ */
+static void wq_wait(wait_queue *q, wq_waiter *w, int need, bool front, pthread_mutex_t *m){
+    wq_push(q, w, need, front);
+    while(!w->signalled){
+        pthread_cond_wait(&w->cond, m);
+    }
+}
+
+/**
+ * Function to wake, in FIFO order, the waiters of a resource type whose requests fit in the available instances.
+ * Waiters that do not fit are skipped and keep their place. Must be called with the mutex protecting the queue held.
+ * @param q Queue of the resource type
+ * @param available Number of instances currently available
+ * @return Return the number of waiters woken.
+ */
+static int wq_wake(wait_queue *q, int available){
+    int woken = 0;
+    wq_waiter *w = q->head;
+    while(w != NULL && available > 0){
+        wq_waiter *next = w->next;
+        if(w->need <= available){
+            available -= w->need;
+            wq_unlink(w);
+            wq_signal(w);
+            woken += 1;
+        }
+        w = next;
+    }
+    return woken;
+}
+
+/**
+ * Function to remove a waiter from the queue it waits on, if any, and wake it. Used when the thread is terminated.
+ * Must be called with the mutex protecting the queue held.
+ */
+static void wq_cancel(wq_waiter *w){
+    if(w->queue == NULL)
+        return;
+    wq_unlink(w);
+    wq_signal(w);
+}
+
+#endif
@@ -0,0 +1,183 @@
+#ifndef WORKLIST_DLOCK_H
+#define WORKLIST_DLOCK_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "simd_kernels.h"
+
+/* Entry of a per-resource wait list: a thread and its outstanding request for that resource type. */
+typedef struct {
+    int req;    /* Outstanding request[thr][j] */
+    int thr;    /* Thread index */
+} wl_entry;
+
+/**
+ * Function to sort a wait list by request, stably: the entries are gathered in thread order, so threads with the same
+ * request stay ordered by index. A merge sort instead of qsort(), which may take its own buffer from the heap.
+ * @param tmp Scratch of at least n / 2 entries
+ */
+static void wl_sort(wl_entry *a, int n, wl_entry *tmp){
+    if(n <= 16){
+        for(int k = 1; k < n; k++){
+            wl_entry e = a[k];
+            int p = k;
+            while(p > 0 && a[p - 1].req > e.req){
+                a[p] = a[p - 1];
+                p -= 1;
+            }
+            a[p] = e;
+        }
+        return;
+    }
+    int h = n / 2;
+    wl_sort(a, h, tmp);
+    wl_sort(a + h, n - h, tmp);
+    if(a[h - 1].req <= a[h].req)
+        return;     /* Already in order */
+    memcpy(tmp, a, sizeof(wl_entry) * h);
+    int i = 0, j = h, k = 0;
+    while(i < h && j < n){
+        a[k++] = (a[j].req < tmp[i].req) ? a[j++] : tmp[i++];
+    }
+    while(i < h){
+        a[k++] = tmp[i++];
+    }
+}
+
+/**
+ * Worklist based reduction of the resource allocation state.
+ * For every resource type j, the unfinished threads whose request[i][j] exceeds work[j] are kept sorted by that request.
+ * need[i] counts the resource types still blocking thread i. Whenever work[j] grows, only the front of the j-th list is
+ * advanced, so every (thread, resource) pair is visited a constant number of times and a full reduction costs
+ * O(n.m.log n) instead of the O(n^2.m) of repeated rescans.
+ * @param n_thr Number of threads (rows)
+ * @param n_rcs Number of resource types (columns)
+ * @param alloc Allocation matrix
+ * @param req Request matrix
+ * @param req_t Optional resource-major copy of the request matrix (req_t[j * ld_t + i] == req[i][j]), or NULL. When
+ * given, the per-resource lists are gathered by scanning columns sequentially.
+ * @param ld_t Length of a column of req_t
+ * @param work Available instances on entry, instances available after the reduction on return
+ * @param finish finish[i] is true on entry for threads that are already considered finished, and true on return for
+ * every thread that can run to completion
+ * @param scratch Arena of the caller, which the lists and counters are taken from and given back to on return
+ * @return Return the number of threads that could not be finished, or -1 if a size is negative or the scratch memory
+ * could not be allocated.
+ */
+static int worklist_reduce(int n_thr, int n_rcs, int **alloc, int **req, const int *req_t, int ld_t, int work[],
+                           bool finish[], arena *scratch){
+    if(n_thr < 0 || n_rcs < 0)
+        return -1;
+    ar_mark mark = ar_save(scratch);
+    int *need = (int *)ar_alloc(scratch, sizeof(int) * ((size_t)n_thr + 1));
+    int *stack = (int *)ar_alloc(scratch, sizeof(int) * ((size_t)n_thr + 1));
+    int *head = (int *)ar_alloc(scratch, sizeof(int) * ((size_t)n_rcs + 1)); /* Next entry of list j to be satisfied */
+    int *end = (int *)ar_alloc(scratch, sizeof(int) * ((size_t)n_rcs + 1));
+    if(need == NULL || stack == NULL || head == NULL || end == NULL){
+        ar_restore(scratch, mark);
+        return -1;
+    }
+    memset(need, 0, sizeof(int) * ((size_t)n_thr + 1));
+    memset(end, 0, sizeof(int) * ((size_t)n_rcs + 1));
+
+    /* Counting the blocked entries of every resource type to lay the lists out back to back in one buffer */
+    size_t total = 0;
+    if(req_t != NULL){
+        for(int j = 0; j < n_rcs; j++){
+            const int *col = req_t + (size_t)j * ld_t;
+            for(int i = 0; i < n_thr; i++){
+                if(!finish[i] && col[i] > work[j])
+                    end[j + 1] += 1;
+            }
+            total += end[j + 1];
+        }
+    }else{
+        for(int i = 0; i < n_thr; i++){
+            if(finish[i] || row_le(req[i], work, n_rcs))
+                continue;
+            for(int j = 0; j < n_rcs; j++){
+                if(req[i][j] > work[j]){
+                    end[j + 1] += 1;
+                    total += 1;
+                }
+            }
+        }
+    }
+    for(int j = 0; j < n_rcs; j++){
+        end[j + 1] += end[j];
+        head[j] = end[j];
+    }
+    wl_entry *entries = (wl_entry *)ar_alloc(scratch, sizeof(wl_entry) * (total + 1));
+    wl_entry *tmp = (wl_entry *)ar_alloc(scratch, sizeof(wl_entry) * (total / 2 + 1));
+    if(entries == NULL || tmp == NULL){
+        ar_restore(scratch, mark);
+        return -1;
+    }
+    if(req_t != NULL){
+        for(int j = 0; j < n_rcs; j++){
+            const int *col = req_t + (size_t)j * ld_t;
+            for(int i = 0; i < n_thr; i++){
+                if(!finish[i] && col[i] > work[j]){
+                    entries[head[j]].req = col[i];
+                    entries[head[j]].thr = i;
+                    head[j] += 1;
+                    need[i] += 1;
+                }
+            }
+        }
+    }else{
+        for(int i = 0; i < n_thr; i++){
+            if(finish[i] || row_le(req[i], work, n_rcs))
+                continue;
+            for(int j = 0; j < n_rcs; j++){
+                if(req[i][j] > work[j]){
+                    entries[head[j]].req = req[i][j];
+                    entries[head[j]].thr = i;
+                    head[j] += 1;
+                    need[i] += 1;
+                }
+            }
+        }
+    }
+    for(int j = 0; j < n_rcs; j++){
+        head[j] = end[j];
+        wl_sort(entries + end[j], end[j + 1] - end[j], tmp);
+    }
+
+    /* Threads which are not blocked by any resource type can finish right away */
+    int top = 0, unfinished = 0;
+    for(int i = 0; i < n_thr; i++){
+        if(finish[i])
+            continue;
+        unfinished += 1;
+        if(need[i] == 0)
+            stack[top++] = i;
+    }
+
+    while(top > 0){
+        int i = stack[--top];
+        finish[i] = true;
+        unfinished -= 1;
+        row_add(work, alloc[i], n_rcs);
+        for(int j = 0; j < n_rcs; j++){
+            if(alloc[i][j] == 0)
+                continue;
+            /* Only the threads whose request for j has just become satisfiable are revisited */
+            while(head[j] < end[j + 1] && entries[head[j]].req <= work[j]){
+                int t = entries[head[j]].thr;
+                head[j] += 1;
+                need[t] -= 1;
+                if(need[t] == 0)
+                    stack[top++] = t;
+            }
+        }
+    }
+
+    ar_restore(scratch, mark);
+    return unfinished;
+}
+
+#endif
@@ -0,0 +1,187 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Workload profiles of the worker threads.
+ * A profile decides what a thread claims in every request set, which resource type it asks for next, how long it
+ * pauses between two requests and how long it holds a complete set. Every decision draws from the thread's own seed,
+ * so that the discrete-event simulation stays deterministic for every profile. Profiles are entries of wl_profiles[];
+ * a new profile is a new entry and a new value of the enum, in the same order.
+ *
+ *   uniform  every resource type claimed uniformly from 0 to its instances, in a random order (the original workload)
+ *   zipf     a few resource types, drawn with probabilities 1/rank (Zipf, s = 1): the first types are hot
+ *   bursty   uniform sets arriving in bursts: four sets in quick succession, then an idle gap of 2 to 4 intervals
+ *   small    at most a quarter of the instances of every resource type
+ *   greedy   every instance of every resource type
+ *   ordered  uniform sets acquired in a fixed order, from the first resource type to the last
+ */
+
+enum {
+    WL_UNIFORM = 0,
+    WL_ZIPF,
+    WL_BURSTY,
+    WL_SMALL,
+    WL_GREEDY,
+    WL_ORDERED,
+    WL_N_PROFILES
+};
+
+#define WL_BURST 4  /* Request sets of a burst */
+
+typedef struct {
+    const char *name;
+    /* Fills the request row of a new request set */
+    void (*request_set)(int *row, int n_rcs, const int *max_available, unsigned int *seed);
+    /* Picks the next resource type whose request is not complete */
+    int (*next_rcs)(const bool acq[], int n_rcs, unsigned int *seed);
+    /* Pause between two requests, and time a complete set is held, in seconds; k counts the sets generated before */
+    double (*pause)(unsigned int *seed);
+    double (*hold)(double interval, int k, unsigned int *seed);
+} wl_profile;
+
+static double *wl_zipf_cdf = NULL;  /* Cumulative probabilities of the resource types under Zipf */
+static int wl_zipf_n = 0;
+
+static double wl_uniform01(unsigned int *seed){
+    return ((double)rand_r(seed)) / ((double)RAND_MAX);
+}
+
+static void wl_set_uniform(int *row, int n_rcs, const int *max_available, unsigned int *seed){
+    for(int i = 0; i < n_rcs; i++){
+        row[i] = rand_r(seed) % (max_available[i] + 1);
+    }
+}
+
+static int wl_zipf_draw(unsigned int *seed){
+    double u = wl_uniform01(seed);
+    int lo = 0, hi = wl_zipf_n - 1;
+    while(lo < hi){
+        int mid = (lo + hi) / 2;
+        if(wl_zipf_cdf[mid] < u)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static void wl_set_zipf(int *row, int n_rcs, const int *max_available, unsigned int *seed){
+    for(int i = 0; i < n_rcs; i++){
+        row[i] = 0;
+    }
+    if(n_rcs <= 0)
+        return;
+    int draws = 1 + rand_r(seed) % ((n_rcs + 1) / 2);
+    for(int d = 0; d < draws; d++){
+        int i = wl_zipf_draw(seed);
+        row[i] = (max_available[i] > 0) ? 1 + rand_r(seed) % max_available[i] : 0;
+    }
+}
+
+static void wl_set_small(int *row, int n_rcs, const int *max_available, unsigned int *seed){
+    for(int i = 0; i < n_rcs; i++){
+        row[i] = rand_r(seed) % (max_available[i] / 4 + 1);
+    }
+}
+
+static void wl_set_greedy(int *row, int n_rcs, const int *max_available, unsigned int *seed){
+    (void)seed;
+    for(int i = 0; i < n_rcs; i++){
+        row[i] = max_available[i];
+    }
+}
+
+static int wl_next_random(const bool acq[], int n_rcs, unsigned int *seed){
+    int r = rand_r(seed) % n_rcs;
+    while(acq[r]){
+        r = rand_r(seed) % n_rcs;
+    }
+    return r;
+}
+
+static int wl_next_ordered(const bool acq[], int n_rcs, unsigned int *seed){
+    (void)seed;
+    int r = 0;
+    while(r < n_rcs - 1 && acq[r])
+        r++;
+    return r;
+}
+
+/* Pause in [0, 1) seconds */
+static double wl_pause_uniform(unsigned int *seed){
+    return wl_uniform01(seed);
+}
+
+/* Pause in [0, 0.1) seconds, within a burst */
+static double wl_pause_short(unsigned int *seed){
+    return 0.1 * wl_uniform01(seed);
+}
+
+/* Hold in [0.7d, 1.5d] */
+static double wl_hold_uniform(double interval, int k, unsigned int *seed){
+    (void)k;
+    return wl_uniform01(seed) * (1.5 * interval - 0.7 * interval) + 0.7 * interval;
+}
+
+/* Hold in [0.1d, 0.3d], followed by an idle gap of [2d, 4d] after the last set of a burst */
+static double wl_hold_bursty(double interval, int k, unsigned int *seed){
+    double hold = wl_uniform01(seed) * 0.2 * interval + 0.1 * interval;
+    if(k % WL_BURST == WL_BURST - 1)
+        hold += wl_uniform01(seed) * 2 * interval + 2 * interval;
+    return hold;
+}
+
+static const wl_profile wl_profiles[WL_N_PROFILES] = {
+    {"uniform", wl_set_uniform, wl_next_random, wl_pause_uniform, wl_hold_uniform},
+    {"zipf", wl_set_zipf, wl_next_random, wl_pause_uniform, wl_hold_uniform},
+    {"bursty", wl_set_uniform, wl_next_random, wl_pause_short, wl_hold_bursty},
+    {"small", wl_set_small, wl_next_random, wl_pause_uniform, wl_hold_uniform},
+    {"greedy", wl_set_greedy, wl_next_random, wl_pause_uniform, wl_hold_uniform},
+    {"ordered", wl_set_uniform, wl_next_ordered, wl_pause_uniform, wl_hold_uniform}
+};
+
+/**
+ * Function to find a profile by its name.
+ * @return Return the profile, or -1 if there is none of that name.
+ */
+static int wl_find(const char *name){
+    for(int p = 0; p < WL_N_PROFILES; p++){
+        if(strcmp(name, wl_profiles[p].name) == 0)
+            return p;
+    }
+    return -1;
+}
+
+/**
+ * Function to set up the tables of the profiles for a number of resource types.
+ * @return Return true on success.
+ */
+static inline bool wl_init(int n_rcs){
+    free(wl_zipf_cdf);
+    wl_zipf_n = (n_rcs > 0) ? n_rcs : 1;
+    wl_zipf_cdf = (double *)malloc(sizeof(double) * wl_zipf_n);
+    if(wl_zipf_cdf == NULL)
+        return false;
+    double sum = 0;
+    for(int i = 0; i < wl_zipf_n; i++){
+        sum += 1.0 / (i + 1);
+        wl_zipf_cdf[i] = sum;
+    }
+    for(int i = 0; i < wl_zipf_n; i++){
+        wl_zipf_cdf[i] /= sum;
+    }
+    wl_zipf_cdf[wl_zipf_n - 1] = 1.0;
+    return true;
+}
+
+static void wl_destroy(void){
+    free(wl_zipf_cdf);
+    wl_zipf_cdf = NULL;
+    wl_zipf_n = 0;
+}
+
+#endif